@@ -192,6 +192,20 @@ public:
     H_dz_dzeta(1, 6) = cam_d(1) * (r_2 + 2 * uv_norm(1) * uv_norm(1));
     H_dz_dzeta(1, 7) = 2 * cam_d(1) * uv_norm(0) * uv_norm(1);
   }
+
+protected:
+  /**
+   * @brief Undistorts a set of raw uv points with a single OpenCV call
+   * @param uv_dist Raw uv coordinates we wish to undistort
+   * @param uv_norm Normalized coordinates
+   */
+  void undistort_points(const std::vector<cv::Point2f> &uv_dist, std::vector<cv::Point2f> &uv_norm) override {
+    if (uv_dist.empty()) {
+      uv_norm.clear();
+      return;
+    }
+    cv::undistortPoints(uv_dist, uv_norm, camera_k_OPENCV, camera_d_OPENCV);
+  }
 };
 
 } // namespace ov_core
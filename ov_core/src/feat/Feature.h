@@ -23,10 +23,12 @@
 #define OV_CORE_FEATURE_H
 
 #include <Eigen/Eigen>
+#include <cassert>
 #include <iostream>
-#include <unordered_map>
 #include <vector>
 
+#include "utils/camera_map.h"
+
 namespace ov_core {
 
 /**
@@ -35,10 +37,23 @@ namespace ov_core {
  * This feature class allows for holding of all tracking information for a given feature.
  * Each feature has a unique ID assigned to it, and should have a set of feature tracks alongside it.
  * See the FeatureDatabase class for details on how we load information into this, and how we delete features.
+ *
+ * The measurements of each camera are stored as separate contiguous arrays of timestamps, uv and normalized uv coordinates.
+ * Each coordinate is a fixed size vector, so appending a measurement does not allocate anything past the amortized array growth.
+ * The cameras themselves are kept in a small flat map (see CameraMap), which does not allocate for mono or stereo.
  */
 class Feature {
 
 public:
+  /// Measurements of a single camera
+  typedef std::vector<Eigen::Vector2f> UVs;
+
+  /// Measurements of all cameras (mapped by camera ID)
+  typedef CameraMap<UVs> CameraUVs;
+
+  /// Measurement times of all cameras (mapped by camera ID)
+  typedef CameraMap<std::vector<double>> CameraTimes;
+
   /// Unique ID of this feature
   size_t featid;
 
@@ -46,13 +61,13 @@ public:
   bool to_delete;
 
   /// UV coordinates that this feature has been seen from (mapped by camera ID)
-  std::unordered_map<size_t, std::vector<Eigen::VectorXf>> uvs;
+  CameraUVs uvs;
 
   /// UV normalized coordinates that this feature has been seen from (mapped by camera ID)
-  std::unordered_map<size_t, std::vector<Eigen::VectorXf>> uvs_norm;
+  CameraUVs uvs_norm;
 
   /// Timestamps of each UV measurement (mapped by camera ID)
-  std::unordered_map<size_t, std::vector<double>> timestamps;
+  CameraTimes timestamps;
 
   /// What camera ID our pose is anchored in!! By default the first measurement is the anchor.
   int anchor_cam_id = -1;
@@ -93,6 +108,42 @@ public:
    * @param timestamp Timestamps that our measurements must occur after
    */
   void clean_older_measurements(double timestamp);
+
+protected:
+  /**
+   * @brief Removes all measurements whose timestamp the passed function returns true for.
+   *
+   * This compacts the arrays of each camera in a single pass, keeping the order of the measurements we keep.
+   *
+   * @param remove Function that returns true if the measurement at this timestamp should be removed
+   */
+  template <typename Func> void clean_measurements(const Func &remove) {
+    for (auto &pair : timestamps) {
+
+      // Assert that we have all the parts of a measurement
+      std::vector<double> &times = pair.second;
+      UVs &uv = uvs[pair.first];
+      UVs &uv_norm = uvs_norm[pair.first];
+      assert(times.size() == uv.size());
+      assert(times.size() == uv_norm.size());
+
+      // Move the measurements we keep to the front
+      size_t ct_keep = 0;
+      for (size_t i = 0; i < times.size(); i++) {
+        if (remove(times[i]))
+          continue;
+        if (ct_keep != i) {
+          times[ct_keep] = times[i];
+          uv[ct_keep] = uv[i];
+          uv_norm[ct_keep] = uv_norm[i];
+        }
+        ct_keep++;
+      }
+      times.resize(ct_keep);
+      uv.resize(ct_keep);
+      uv_norm.resize(ct_keep);
+    }
+  }
 };
 
 } // namespace ov_core
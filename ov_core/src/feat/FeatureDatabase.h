@@ -23,10 +23,16 @@
 #define OV_CORE_FEATURE_DATABASE_H
 
 #include <Eigen/Eigen>
+#include <cmath>
+#include <map>
 #include <memory>
 #include <mutex>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
+#include <opencv2/core/core.hpp>
+
 #include "Feature.h"
 
 namespace ov_core {
@@ -53,11 +59,62 @@ namespace ov_core {
 class FeatureDatabase {
 
 public:
+  /**
+   * @brief A single measurement of a feature.
+   *
+   * Used to pass only the new measurements of a tracker's database to another database.
+   */
+  struct Measurement {
+
+    /// ID of the feature this measurement is of
+    size_t featid;
+
+    /// Time that this measurement occured at
+    double timestamp;
+
+    /// Which camera this measurement was from
+    size_t cam_id;
+
+    /// Raw uv coordinate
+    Eigen::Vector2f uv;
+
+    /// Undistorted/normalized uv coordinate
+    Eigen::Vector2f uv_norm;
+  };
+
   /**
    * @brief Default constructor
    */
   FeatureDatabase() {}
 
+  /**
+   * @brief Sets if we should record all new measurements so they can be retrieved with take_new_measurements().
+   *
+   * This should only be enabled if something will consume the new measurements, otherwise they would be kept forever.
+   * Any measurements recorded so far are cleared when disabling.
+   *
+   * @param record True if we should record new measurements
+   */
+  void set_record_new_measurements(bool record) {
+    std::unique_lock<std::mutex> lck(mtx);
+    record_new = record;
+    if (!record_new)
+      std::vector<Measurement>().swap(measurements_new);
+  }
+
+  /**
+   * @brief Returns all measurements added since the last call, in the order they were added.
+   *
+   * Recording needs to be enabled with set_record_new_measurements(), otherwise this will always be empty.
+   * This just swaps out our recorded measurements, so nothing is copied.
+   */
+  std::vector<Measurement> take_new_measurements() {
+    std::vector<Measurement> measurements;
+    std::unique_lock<std::mutex> lck(mtx);
+    measurements.swap(measurements_new);
+    return measurements;
+  }
+
   /**
    * @brief Get a specified feature
    * @param id What feature we want to get
@@ -69,13 +126,29 @@ public:
     if (features_idlookup.find(id) != features_idlookup.end()) {
       std::shared_ptr<Feature> temp = features_idlookup.at(id);
       if (remove)
-        features_idlookup.erase(id);
+        erase_feature(id);
       return temp;
     } else {
       return nullptr;
     }
   }
 
+  /**
+   * @brief Get a copy of a specified feature
+   * @param id What feature we want to get
+   * @param feat Feature we will copy into
+   * @return False if it is not in the database.
+   *
+   * Unlike get_feature() the returned measurements can safely be read while another thread updates or cleans up this database.
+   */
+  bool get_feature_clone(size_t id, Feature &feat) {
+    std::unique_lock<std::mutex> lck(mtx);
+    if (features_idlookup.find(id) == features_idlookup.end())
+      return false;
+    feat = *features_idlookup.at(id);
+    return true;
+  }
+
   /**
    * @brief Update a feature object
    * @param id ID of the feature we will update
@@ -91,30 +164,53 @@ public:
    */
   void update_feature(size_t id, double timestamp, size_t cam_id, float u, float v, float u_n, float v_n) {
 
-    // Find this feature using the ID lookup
     std::unique_lock<std::mutex> lck(mtx);
-    if (features_idlookup.find(id) != features_idlookup.end()) {
-      // Get our feature
-      std::shared_ptr<Feature> feat = features_idlookup.at(id);
-      // Append this new information to it!
-      feat->uvs[cam_id].push_back(Eigen::Vector2f(u, v));
-      feat->uvs_norm[cam_id].push_back(Eigen::Vector2f(u_n, v_n));
-      feat->timestamps[cam_id].push_back(timestamp);
-      return;
-    }
+    add_measurement(id, timestamp, cam_id, Eigen::Vector2f(u, v), Eigen::Vector2f(u_n, v_n));
+  }
 
-    // Debug info
-    // ROS_INFO("featdb - adding new feature %d",(int)id);
+  /**
+   * @brief Update a set of features which were all seen in the same image
+   * @param ids IDs of the features we will update
+   * @param timestamp time that these measurements occured at
+   * @param cam_id which camera these measurements were from
+   * @param uvs raw uv coordinate of each feature
+   * @param uvs_norm undistorted/normalized uv coordinate of each feature
+   *
+   * This is the same as calling update_feature() for each feature, but we only lock once,
+   * look up the time index once, and reserve space for any new features and recorded measurements up front.
+   */
+  void update_features(const std::vector<size_t> &ids, double timestamp, size_t cam_id, const std::vector<cv::KeyPoint> &uvs,
+                       const std::vector<cv::Point2f> &uvs_norm) {
+    assert(ids.size() == uvs.size());
+    assert(ids.size() == uvs_norm.size());
+    if (ids.empty())
+      return;
 
-    // Else we have not found the feature, so lets make it be a new one!
-    std::shared_ptr<Feature> feat = std::make_shared<Feature>();
-    feat->featid = id;
-    feat->uvs[cam_id].push_back(Eigen::Vector2f(u, v));
-    feat->uvs_norm[cam_id].push_back(Eigen::Vector2f(u_n, v_n));
-    feat->timestamps[cam_id].push_back(timestamp);
+    std::unique_lock<std::mutex> lck(mtx);
+    std::unordered_set<size_t> &ids_at_time = features_idtime[timestamp];
+    ids_at_time.reserve(ids_at_time.size() + ids.size());
+    features_idlookup.reserve(features_idlookup.size() + ids.size());
+    if (record_new)
+      measurements_new.reserve(measurements_new.size() + ids.size());
+    for (size_t i = 0; i < ids.size(); i++) {
+      add_measurement(ids.at(i), timestamp, cam_id, Eigen::Vector2f(uvs.at(i).pt.x, uvs.at(i).pt.y),
+                      Eigen::Vector2f(uvs_norm.at(i).x, uvs_norm.at(i).y), ids_at_time);
+    }
+  }
 
-    // Append this new feature into our database
-    features_idlookup[id] = feat;
+  /**
+   * @brief Appends a set of measurements into this database
+   *
+   * This is O(number of measurements), as we expect these to be new and do not check if we already have them.
+   * For example, the measurements another database has returned from take_new_measurements().
+   *
+   * @param measurements New measurements to add to our features
+   */
+  void append_measurements(const std::vector<Measurement> &measurements) {
+    std::unique_lock<std::mutex> lck(mtx);
+    for (const Measurement &meas : measurements) {
+      add_measurement(meas.featid, meas.timestamp, meas.cam_id, meas.uv, meas.uv_norm);
+    }
   }
 
   /**
@@ -123,39 +219,47 @@ public:
    * This function will return all features that do not a measurement at a time greater than the specified time.
    * For example this could be used to get features that have not been successfully tracked into the newest frame.
    * All features returned will not have any measurements occurring at a time greater then the specified.
+   *
+   * We only need to check the features whose newest measurement we know is older than the specified time.
+   * Thus this is proportional to the number of lost features, not the size of the database.
+   * Note that if the newest measurement of a feature is removed outside of this database we will still think it is its newest.
+   * Our updaters only remove measurements which are not at a clone time, which the newest measurement of a feature always is.
    */
   std::vector<std::shared_ptr<Feature>> features_not_containing_newer(double timestamp, bool remove = false, bool skip_deleted = false) {
 
     // Our vector of features that do not have measurements after the specified time
     std::vector<std::shared_ptr<Feature>> feats_old;
 
-    // Now lets loop through all features, and just make sure they are not old
+    // Now lets loop through all features that were last seen before this time, and just make sure they are not old
     std::unique_lock<std::mutex> lck(mtx);
-    for (auto it = features_idlookup.begin(); it != features_idlookup.end();) {
-      // Skip if already deleted
-      if (skip_deleted && (*it).second->to_delete) {
-        it++;
-        continue;
-      }
-      // Loop through each camera
-      // If we have a measurement greater-than or equal to the specified, this measurement is find
-      bool has_newer_measurement = false;
-      for (auto const &pair : (*it).second->timestamps) {
-        has_newer_measurement = (!pair.second.empty() && pair.second.at(pair.second.size() - 1) >= timestamp);
-        if (has_newer_measurement) {
-          break;
+    for (auto it = features_idnewest.begin(); it != features_idnewest.end() && it->first < timestamp; it++) {
+      for (const size_t &id : it->second) {
+        auto feat = features_idlookup.find(id);
+        if (feat == features_idlookup.end())
+          continue;
+        // Skip if already deleted
+        if (skip_deleted && feat->second->to_delete)
+          continue;
+        // Loop through each camera
+        // If we have a measurement greater-than or equal to the specified, this measurement is find
+        bool has_newer_measurement = false;
+        for (auto const &pair : feat->second->timestamps) {
+          has_newer_measurement = (!pair.second.empty() && pair.second.at(pair.second.size() - 1) >= timestamp);
+          if (has_newer_measurement) {
+            break;
+          }
+        }
+        // If it is not being actively tracked, then it is old
+        if (!has_newer_measurement) {
+          feats_old.push_back(feat->second);
         }
       }
-      // If it is not being actively tracked, then it is old
-      if (!has_newer_measurement) {
-        feats_old.push_back((*it).second);
-        if (remove)
-          features_idlookup.erase(it++);
-        else
-          it++;
-      } else {
-        it++;
-      }
+    }
+
+    // Remove them after we are done looping through our index
+    if (remove) {
+      for (const auto &feat : feats_old)
+        erase_feature(feat->featid);
     }
 
     // Debugging
@@ -176,33 +280,40 @@ public:
     // Our vector of old features
     std::vector<std::shared_ptr<Feature>> feats_old;
 
-    // Now lets loop through all features, and just make sure they are not old
+    // Now lets loop through all features that had a measurement before this time, and just make sure they are still old
+    // NOTE: a feature can be in multiple of our times, so we record which we have checked
     std::unique_lock<std::mutex> lck(mtx);
-    for (auto it = features_idlookup.begin(); it != features_idlookup.end();) {
-      // Skip if already deleted
-      if (skip_deleted && (*it).second->to_delete) {
-        it++;
-        continue;
-      }
-      // Loop through each camera
-      // Check if we have at least one time older then the requested
-      bool found_containing_older = false;
-      for (auto const &pair : (*it).second->timestamps) {
-        found_containing_older = (!pair.second.empty() && pair.second.at(0) < timestamp);
+    std::unordered_set<size_t> ids_checked;
+    for (auto it = features_idtime.begin(); it != features_idtime.end() && it->first < timestamp; it++) {
+      for (const size_t &id : it->second) {
+        if (!ids_checked.insert(id).second)
+          continue;
+        auto feat = features_idlookup.find(id);
+        if (feat == features_idlookup.end())
+          continue;
+        // Skip if already deleted
+        if (skip_deleted && feat->second->to_delete)
+          continue;
+        // Loop through each camera
+        // Check if we have at least one time older then the requested
+        bool found_containing_older = false;
+        for (auto const &pair : feat->second->timestamps) {
+          found_containing_older = (!pair.second.empty() && pair.second.at(0) < timestamp);
+          if (found_containing_older) {
+            break;
+          }
+        }
+        // If it has an older timestamp, then add it
         if (found_containing_older) {
-          break;
+          feats_old.push_back(feat->second);
         }
       }
-      // If it has an older timestamp, then add it
-      if (found_containing_older) {
-        feats_old.push_back((*it).second);
-        if (remove)
-          features_idlookup.erase(it++);
-        else
-          it++;
-      } else {
-        it++;
-      }
+    }
+
+    // Remove them after we are done looping through our index
+    if (remove) {
+      for (const auto &feat : feats_old)
+        erase_feature(feat->featid);
     }
 
     // Debugging
@@ -223,18 +334,24 @@ public:
     // Our vector of old features
     std::vector<std::shared_ptr<Feature>> feats_has_timestamp;
 
-    // Now lets loop through all features, and just make sure they are not
+    // Return if no feature was seen at this time
     std::unique_lock<std::mutex> lck(mtx);
-    for (auto it = features_idlookup.begin(); it != features_idlookup.end();) {
+    auto it = features_idtime.find(timestamp);
+    if (it == features_idtime.end())
+      return feats_has_timestamp;
+
+    // Now lets loop through all features seen at this time, and just make sure they still have the measurement
+    for (const size_t &id : it->second) {
+      auto feat = features_idlookup.find(id);
+      if (feat == features_idlookup.end())
+        continue;
       // Skip if already deleted
-      if (skip_deleted && (*it).second->to_delete) {
-        it++;
+      if (skip_deleted && feat->second->to_delete)
         continue;
-      }
       // Boolean if it has the timestamp
       // Break out if we found a single timestamp that is equal to the specified time
       bool has_timestamp = false;
-      for (auto const &pair : (*it).second->timestamps) {
+      for (auto const &pair : feat->second->timestamps) {
         has_timestamp = (std::find(pair.second.begin(), pair.second.end(), timestamp) != pair.second.end());
         if (has_timestamp) {
           break;
@@ -242,16 +359,16 @@ public:
       }
       // Remove this feature if it contains the specified timestamp
       if (has_timestamp) {
-        feats_has_timestamp.push_back((*it).second);
-        if (remove)
-          features_idlookup.erase(it++);
-        else
-          it++;
-      } else {
-        it++;
+        feats_has_timestamp.push_back(feat->second);
       }
     }
 
+    // Remove them after we are done looping through our index
+    if (remove) {
+      for (const auto &feat : feats_has_timestamp)
+        erase_feature(feat->featid);
+    }
+
     // Debugging
     // std::cout << "feature db size = " << features_idlookup.size() << std::endl;
     // std::cout << "return vector = " << feats_has_timestamp.size() << std::endl;
@@ -269,14 +386,14 @@ public:
     // Loop through all features
     // int sizebefore = (int)features_idlookup.size();
     std::unique_lock<std::mutex> lck(mtx);
-    for (auto it = features_idlookup.begin(); it != features_idlookup.end();) {
+    std::vector<size_t> ids_delete;
+    for (const auto &feat : features_idlookup) {
       // If delete flag is set, then delete it
-      if ((*it).second->to_delete) {
-        features_idlookup.erase(it++);
-      } else {
-        it++;
-      }
+      if (feat.second->to_delete)
+        ids_delete.push_back(feat.first);
     }
+    for (const size_t &id : ids_delete)
+      erase_feature(id);
     // std::cout << "feat db = " << sizebefore << " -> " << (int)features_idlookup.size() << std::endl;
   }
 
@@ -285,19 +402,29 @@ public:
    */
   void cleanup_measurements(double timestamp) {
     std::unique_lock<std::mutex> lck(mtx);
-    for (auto it = features_idlookup.begin(); it != features_idlookup.end();) {
-      // Remove the older measurements
-      (*it).second->clean_older_measurements(timestamp);
+
+    // Features that had measurements at or before this time
+    std::unordered_set<size_t> ids_older;
+    auto it = features_idtime.begin();
+    while (it != features_idtime.end() && it->first <= timestamp) {
+      ids_older.insert(it->second.begin(), it->second.end());
+      it = features_idtime.erase(it);
+    }
+
+    // Remove the older measurements from them
+    for (const size_t &id : ids_older) {
+      auto feat = features_idlookup.find(id);
+      if (feat == features_idlookup.end())
+        continue;
+      feat->second->clean_older_measurements(timestamp);
       // Count how many measurements
       int ct_meas = 0;
-      for (const auto &pair : (*it).second->timestamps) {
+      for (const auto &pair : feat->second->timestamps) {
         ct_meas += (int)(pair.second.size());
       }
       // If delete flag is set, then delete it
       if (ct_meas < 1) {
-        features_idlookup.erase(it++);
-      } else {
-        it++;
+        erase_feature(id);
       }
     }
   }
@@ -307,20 +434,38 @@ public:
    */
   void cleanup_measurements_exact(double timestamp) {
     std::unique_lock<std::mutex> lck(mtx);
+
+    // Features that had measurements at this time
+    auto it = features_idtime.find(timestamp);
+    if (it == features_idtime.end())
+      return;
+    std::unordered_set<size_t> ids_exact;
+    ids_exact.swap(it->second);
+    features_idtime.erase(it);
+
+    // Remove the measurements from them
     std::vector<double> timestamps = {timestamp};
-    for (auto it = features_idlookup.begin(); it != features_idlookup.end();) {
-      // Remove the older measurements
-      (*it).second->clean_invalid_measurements(timestamps);
+    for (const size_t &id : ids_exact) {
+      auto feat = features_idlookup.find(id);
+      if (feat == features_idlookup.end())
+        continue;
+      feat->second->clean_invalid_measurements(timestamps);
       // Count how many measurements
       int ct_meas = 0;
-      for (const auto &pair : (*it).second->timestamps) {
+      for (const auto &pair : feat->second->timestamps) {
         ct_meas += (int)(pair.second.size());
       }
       // If delete flag is set, then delete it
+      // Else this might have been our newest measurement, so find the new one
       if (ct_meas < 1) {
-        features_idlookup.erase(it++);
-      } else {
-        it++;
+        erase_feature(id);
+      } else if (features_newest.at(id) == timestamp) {
+        double newest = -INFINITY;
+        for (const auto &pair : feat->second->timestamps) {
+          if (!pair.second.empty())
+            newest = std::max(newest, pair.second.at(pair.second.size() - 1));
+        }
+        set_newest_time(id, newest);
       }
     }
   }
@@ -342,9 +487,18 @@ public:
   }
 
   /**
-   * @brief Will update the passed database with this database's latest feature information.
+   * @brief Will update this database with the passed database's latest feature information.
+   *
+   * If the passed database records its new measurements (see set_record_new_measurements()), then we only append the measurements
+   * it has gotten since the last call, which does not need to copy or search its features.
+   * Note that this consumes its new measurements, so only a single database should be appending from it.
+   * Otherwise, we fall back to looping through all its features and appending any measurements we do not yet have.
    */
   void append_new_measurements(const std::shared_ptr<FeatureDatabase> &database) {
+    if (database->is_recording_new_measurements()) {
+      append_measurements(database->take_new_measurements());
+      return;
+    }
     std::unique_lock<std::mutex> lck(mtx);
 
     // Loop through the other database's internal database
@@ -362,6 +516,8 @@ public:
             temp->timestamps[cam_id] = feat.second->timestamps.at(cam_id);
             temp->uvs[cam_id] = feat.second->uvs.at(cam_id);
             temp->uvs_norm[cam_id] = feat.second->uvs_norm.at(cam_id);
+            for (const double &time : temp->timestamps.at(cam_id))
+              index_measurement(feat.first, time);
           } else {
             auto temp_times = temp->timestamps.at(cam_id);
             for (size_t i = 0; i < feat.second->timestamps.at(cam_id).size(); i++) {
@@ -370,6 +526,7 @@ public:
                 temp->timestamps.at(cam_id).push_back(feat.second->timestamps.at(cam_id).at(i));
                 temp->uvs.at(cam_id).push_back(feat.second->uvs.at(cam_id).at(i));
                 temp->uvs_norm.at(cam_id).push_back(feat.second->uvs_norm.at(cam_id).at(i));
+                index_measurement(feat.first, time_to_find);
               }
             }
           }
@@ -384,17 +541,131 @@ public:
         temp->uvs = feat.second->uvs;
         temp->uvs_norm = feat.second->uvs_norm;
         features_idlookup[feat.first] = temp;
+        for (const auto &times : temp->timestamps) {
+          for (const double &time : times.second)
+            index_measurement(feat.first, time);
+        }
       }
     }
     // std::cout << "feat db = " << sizebefore << " -> " << (int)features_idlookup.size() << std::endl;
   }
 
+  /// If we are recording our new measurements
+  bool is_recording_new_measurements() {
+    std::unique_lock<std::mutex> lck(mtx);
+    return record_new;
+  }
+
 protected:
+  /// Adds a measurement to a feature, creating it if it is an ID that we have not seen before (mutex should be locked)
+  void add_measurement(size_t id, double timestamp, size_t cam_id, const Eigen::Vector2f &uv, const Eigen::Vector2f &uv_norm) {
+    add_measurement(id, timestamp, cam_id, uv, uv_norm, features_idtime[timestamp]);
+  }
+
+  /// Adds a measurement to a feature, given the IDs of the features which have a measurement at its time (mutex should be locked)
+  void add_measurement(size_t id, double timestamp, size_t cam_id, const Eigen::Vector2f &uv, const Eigen::Vector2f &uv_norm,
+                       std::unordered_set<size_t> &ids_at_time) {
+
+    // Find this feature using the ID lookup
+    // Else we have not found the feature, so lets make it be a new one!
+    std::shared_ptr<Feature> &feat = features_idlookup[id];
+    if (feat == nullptr) {
+      feat = std::make_shared<Feature>();
+      feat->featid = id;
+    }
+
+    // Append this new information to it!
+    feat->uvs[cam_id].push_back(uv);
+    feat->uvs_norm[cam_id].push_back(uv_norm);
+    feat->timestamps[cam_id].push_back(timestamp);
+    index_measurement(id, timestamp, ids_at_time);
+
+    // Record it if someone wants our new measurements
+    if (record_new) {
+      Measurement meas;
+      meas.featid = id;
+      meas.timestamp = timestamp;
+      meas.cam_id = cam_id;
+      meas.uv = uv;
+      meas.uv_norm = uv_norm;
+      measurements_new.push_back(meas);
+    }
+  }
+
+  /// Adds a new measurement of a feature to our time indexes (mutex should be locked)
+  void index_measurement(size_t id, double timestamp) { index_measurement(id, timestamp, features_idtime[timestamp]); }
+
+  /// Adds a new measurement of a feature to our time indexes, given the IDs at its time (mutex should be locked)
+  void index_measurement(size_t id, double timestamp, std::unordered_set<size_t> &ids_at_time) {
+    ids_at_time.insert(id);
+    auto it = features_newest.find(id);
+    if (it == features_newest.end() || it->second < timestamp) {
+      set_newest_time(id, timestamp);
+    }
+  }
+
+  /// Moves a feature to a new newest measurement time (mutex should be locked)
+  void set_newest_time(size_t id, double timestamp) {
+    auto it = features_newest.find(id);
+    if (it != features_newest.end()) {
+      auto it_ids = features_idnewest.find(it->second);
+      it_ids->second.erase(id);
+      if (it_ids->second.empty())
+        features_idnewest.erase(it_ids);
+    }
+    features_newest[id] = timestamp;
+    features_idnewest[timestamp].insert(id);
+  }
+
+  /// Removes a feature from our database and all its indexes (mutex should be locked)
+  void erase_feature(size_t id) {
+    auto feat = features_idlookup.find(id);
+    if (feat == features_idlookup.end())
+      return;
+    for (const auto &pair : feat->second->timestamps) {
+      for (const double &time : pair.second) {
+        auto it_ids = features_idtime.find(time);
+        if (it_ids == features_idtime.end())
+          continue;
+        it_ids->second.erase(id);
+        if (it_ids->second.empty())
+          features_idtime.erase(it_ids);
+      }
+    }
+    auto it = features_newest.find(id);
+    if (it != features_newest.end()) {
+      auto it_ids = features_idnewest.find(it->second);
+      it_ids->second.erase(id);
+      if (it_ids->second.empty())
+        features_idnewest.erase(it_ids);
+      features_newest.erase(it);
+    }
+    features_idlookup.erase(feat);
+  }
+
   /// Mutex lock for our map
   std::mutex mtx;
 
   /// Our lookup array that allow use to query based on ID
   std::unordered_map<size_t, std::shared_ptr<Feature>> features_idlookup;
+
+  /**
+   * @brief IDs of the features that have a measurement at each time
+   *
+   * If measurements are removed from a feature outside of this database this can contain extra IDs.
+   * Thus this is only used to find candidate features, which we then check.
+   */
+  std::map<double, std::unordered_set<size_t>> features_idtime;
+
+  /// Time of the newest measurement of each feature
+  std::unordered_map<size_t, double> features_newest;
+
+  /// IDs of the features by the time of their newest measurement
+  std::map<double, std::unordered_set<size_t>> features_idnewest;
+
+  /// If we should record new measurements, and the measurements added since they were last taken
+  bool record_new = false;
+  std::vector<Measurement> measurements_new;
 };
 
 } // namespace ov_core
@@ -25,14 +25,9 @@ using namespace ov_core;
 
 void InertialInitializer::feed_imu(const ImuData &message) {
 
-  // Append it to our vector
-  imu_data.push_back(message);
-
-  // Delete all measurements older than three of our initialization windows
-  auto it0 = imu_data.begin();
-  while (it0 != imu_data.end() && it0->timestamp < message.timestamp - 3 * _window_length) {
-    it0 = imu_data.erase(it0);
-  }
+  // Append it to our buffer
+  // If we own it, this will delete all measurements older than three of our initialization windows
+  imu_data->feed(message);
 }
 
 bool InertialInitializer::initialize_with_imu(double &time0, Eigen::Matrix<double, 4, 1> &q_GtoI0, Eigen::Matrix<double, 3, 1> &b_w0,
@@ -40,13 +35,13 @@ bool InertialInitializer::initialize_with_imu(double &time0, Eigen::Matrix<doubl
                                               Eigen::Matrix<double, 3, 1> &p_I0inG, bool wait_for_jerk) {
 
   // Return if we don't have any measurements
-  if (imu_data.size() < 2) {
+  if (imu_data->size() < 2) {
     return false;
   }
 
   // Newest and oldest imu timestamp
-  double newesttime = imu_data.at(imu_data.size() - 1).timestamp;
-  double oldesttime = imu_data.at(0).timestamp;
+  double newesttime = imu_data->back().timestamp;
+  double oldesttime = imu_data->front().timestamp;
 
   // Return if we don't have enough for two windows
   if (newesttime - oldesttime < 2 * _window_length) {
@@ -55,15 +50,8 @@ bool InertialInitializer::initialize_with_imu(double &time0, Eigen::Matrix<doubl
   }
 
   // First lets collect a window of IMU readings from the newest measurement to the oldest
-  std::vector<ImuData> window_1to0, window_2to1;
-  for (const ImuData &data : imu_data) {
-    if (data.timestamp > newesttime - 1 * _window_length && data.timestamp <= newesttime - 0 * _window_length) {
-      window_1to0.push_back(data);
-    }
-    if (data.timestamp > newesttime - 2 * _window_length && data.timestamp <= newesttime - 1 * _window_length) {
-      window_2to1.push_back(data);
-    }
-  }
+  std::vector<ImuData> window_1to0 = imu_data->get_window(newesttime - 1 * _window_length, newesttime - 0 * _window_length);
+  std::vector<ImuData> window_2to1 = imu_data->get_window(newesttime - 2 * _window_length, newesttime - 1 * _window_length);
 
   // Return if both of these failed
   if (window_1to0.empty() || window_2to1.empty()) {
@@ -22,7 +22,10 @@
 #ifndef OV_CORE_INERTIALINITIALIZER_H
 #define OV_CORE_INERTIALINITIALIZER_H
 
+#include <memory>
+
 #include "utils/colors.h"
+#include "utils/imu_buffer.h"
 #include "utils/quat_ops.h"
 #include "utils/sensor_data.h"
 
@@ -51,10 +54,17 @@ public:
    * @param gravity_mag Global gravity magnitude of the system (normally 9.81)
    * @param window_length Amount of time we will initialize over (seconds)
    * @param imu_excite_threshold Variance threshold on our acceleration to be classified as moving
+   * @param imu_buffer Inertial readings buffer to use (can be shared with others), if null we will create our own
+   *
+   * If a buffer is passed it should hold at least three of our initialization windows of readings.
    */
-  InertialInitializer(double gravity_mag, double window_length, double imu_excite_threshold)
-      : _window_length(window_length), _imu_excite_threshold(imu_excite_threshold) {
+  InertialInitializer(double gravity_mag, double window_length, double imu_excite_threshold,
+                      std::shared_ptr<ImuBuffer> imu_buffer = nullptr)
+      : _window_length(window_length), _imu_excite_threshold(imu_excite_threshold), imu_data(imu_buffer) {
     _gravity << 0.0, 0.0, gravity_mag;
+    if (imu_data == nullptr) {
+      imu_data = std::make_shared<ImuBuffer>(3 * _window_length);
+    }
   }
 
   /**
@@ -98,7 +108,7 @@ protected:
   double _imu_excite_threshold;
 
   /// Our history of IMU messages (time, angular, linear)
-  std::vector<ImuData> imu_data;
+  std::shared_ptr<ImuBuffer> imu_data;
 };
 
 } // namespace ov_core
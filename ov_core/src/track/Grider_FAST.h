@@ -23,6 +23,7 @@
 #define OV_CORE_GRIDER_FAST_H
 
 #include <Eigen/Eigen>
+#include <algorithm>
 #include <functional>
 #include <iostream>
 #include <vector>
@@ -72,6 +73,31 @@ public:
    */
   static void perform_griding(const cv::Mat &img, const cv::Mat &mask, std::vector<cv::KeyPoint> &pts, int num_features, int grid_x,
                               int grid_y, int threshold, bool nonmaxSuppression) {
+    perform_griding(img, mask, std::vector<cv::KeyPoint>(), pts, num_features, num_features, grid_x, grid_y, threshold, nonmaxSuppression);
+  }
+
+  /**
+   * @brief This function will perform grid extraction using FAST, only in grid cells which need more features.
+   * @param img Image we will do FAST extraction on
+   * @param mask Region of the image we do not want to extract features in (255 = do not detect features)
+   * @param pts_existing features we already have in this image (e.g. from tracking)
+   * @param pts vector of extracted points we will return
+   * @param num_features total number of features we want in the image (including the existing ones)
+   * @param num_needed max number of new features we want to extract
+   * @param grid_x size of grid in the x-direction / u-direction
+   * @param grid_y size of grid in the y-direction / v-direction
+   * @param threshold FAST threshold paramter (10 is a good value normally)
+   * @param nonmaxSuppression if FAST should perform non-max suppression (true normally)
+   *
+   * Each grid cell has a quota of features so they are equally distributed over the image.
+   * We count how many of the existing features are in each cell, and only run FAST (and sort its response) in the cells
+   * which are below their quota, returning the best points needed to fill them.
+   * Thus when most of our features are tracked, only a few cells need to be extracted from.
+   * Since every cell below its quota is filled up to it, we only keep the best num_needed points by their response.
+   */
+  static void perform_griding(const cv::Mat &img, const cv::Mat &mask, const std::vector<cv::KeyPoint> &pts_existing,
+                              std::vector<cv::KeyPoint> &pts, int num_features, int num_needed, int grid_x, int grid_y,
+                              int threshold, bool nonmaxSuppression) {
 
     // Calculate the size our extraction boxes should be
     int size_x = img.cols / grid_x;
@@ -85,13 +111,32 @@ public:
     // 每个小网格需要的特征点数量
     auto num_features_grid = (int)(num_features / (grid_x * grid_y)) + 1;
 
-    // Parallelize our 2d grid extraction!!
+    // Count how many of our existing features are in each cell
     int ct_cols = std::floor(img.cols / size_x);
     int ct_rows = std::floor(img.rows / size_y);
+    std::vector<int> num_existing(ct_cols * ct_rows, 0);
+    for (const auto &kpt : pts_existing) {
+      int cell_x = (int)(kpt.pt.x / (float)size_x);
+      int cell_y = (int)(kpt.pt.y / (float)size_y);
+      if (cell_x < 0 || cell_x >= ct_cols || cell_y < 0 || cell_y >= ct_rows)
+        continue;
+      num_existing.at(cell_y * ct_cols + cell_x)++;
+    }
+
+    // Only extract from the cells which are below their quota
+    std::vector<int> cells;
+    for (int r = 0; r < ct_cols * ct_rows; r++) {
+      if (num_existing.at(r) < num_features_grid)
+        cells.push_back(r);
+    }
+
+    // Parallelize our 2d grid extraction!!
     std::vector<std::vector<cv::KeyPoint>> collection(ct_cols * ct_rows);
-    parallel_for_(cv::Range(0, ct_cols * ct_rows), LambdaBody([&](const cv::Range &range) {
-                    for (int r = range.start; r < range.end; r++) {
+    parallel_for_(cv::Range(0, (int)cells.size()), LambdaBody([&](const cv::Range &range) {
+                    for (int c = range.start; c < range.end; c++) {
                       // Calculate what cell xy value we are in
+                      int r = cells.at(c);
+                      int num_needed_grid = num_features_grid - num_existing.at(r);
                       int x = r % ct_cols * size_x;
                       int y = r / ct_cols * size_y;
 
@@ -113,7 +158,7 @@ public:
                       // Append the "best" ones to our vector
                       // Note that we need to "correct" the point u,v since we extracted it in a ROI
                       // So we should append the location of that ROI in the image
-                      for (size_t i = 0; i < (size_t)num_features_grid && i < pts_new.size(); i++) {
+                      for (size_t i = 0; i < (size_t)num_needed_grid && i < pts_new.size(); i++) {
 
                         // Create keypoint
                         cv::KeyPoint pt_cor = pts_new.at(i);
@@ -136,9 +181,17 @@ public:
 
     // Combine all the collections into our single vector
     // 收集所有特征点
+    std::vector<cv::KeyPoint> pts_all;
     for (size_t r = 0; r < collection.size(); r++) {
-      pts.insert(pts.end(), collection.at(r).begin(), collection.at(r).end());
+      pts_all.insert(pts_all.end(), collection.at(r).begin(), collection.at(r).end());
+    }
+
+    // If the cells gave us more than we need, then only keep the best ones
+    if ((int)pts_all.size() > num_needed) {
+      std::nth_element(pts_all.begin(), pts_all.begin() + std::max(num_needed, 0), pts_all.end(), Grider_FAST::compare_response);
+      pts_all.resize(std::max(num_needed, 0));
     }
+    pts.insert(pts.end(), pts_all.begin(), pts_all.end());
 
     // Return if no points
     if (pts.empty())
@@ -0,0 +1,170 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2021 Patrick Geneva
+ * Copyright (C) 2021 Guoquan Huang
+ * Copyright (C) 2021 OpenVINS Contributors
+ * Copyright (C) 2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OV_CORE_PYRAMID_CACHE_H
+#define OV_CORE_PYRAMID_CACHE_H
+
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+namespace ov_core {
+
+/**
+ * @brief Per camera storage of the last and new image along with their KLT image pyramids.
+ *
+ * Each camera has two sets of buffers which we swap between, one for the last image and one for the new image.
+ * The new image is always written into the buffers of the image before the last, so after the first couple of images
+ * OpenCV can write into the already allocated memory and nothing is allocated per frame.
+ * The same pyramids are used for temporal tracking, stereo matching, and detection (the first level), while the
+ * last image is what we visualize.
+ *
+ * If someone else still has a reference to a buffer we are about to write into (e.g. a visualization of an old image),
+ * we give up our reference to it instead, so their image is never changed underneath them.
+ *
+ * Cameras need to be added before tracking starts, after which each camera can be used from its own thread.
+ */
+class PyramidCache {
+
+public:
+  /**
+   * @brief Default constructor
+   * @param win_size KLT window size the pyramids will be tracked with
+   * @param levels Number of pyramid levels to build
+   */
+  PyramidCache(cv::Size win_size, int levels) : _win_size(win_size), _levels(levels) {}
+
+  /**
+   * @brief Adds storage for a camera (not thread safe, should be done for all cameras on startup)
+   * @param cam_id Id of the camera
+   */
+  void add_camera(size_t cam_id) { _cameras[cam_id]; }
+
+  /**
+   * @brief Buffer the new image of a camera can be written into (e.g. by histogram equalization)
+   * @param cam_id Id of the camera
+   * @return Image buffer which is not the last image
+   */
+  cv::Mat &next_image(size_t cam_id) {
+    CameraBuffers &buffers = _cameras.at(cam_id);
+    std::lock_guard<std::mutex> lck(buffers.mtx);
+    cv::Mat &img = buffers.img[1 - buffers.last];
+    release_if_shared(img);
+    return img;
+  }
+
+  /**
+   * @brief Builds the pyramid of the new image of a camera into our buffers
+   * @param cam_id Id of the camera
+   * @param img New image (can be the one in next_image())
+   * @return Pyramid of the new image
+   */
+  const std::vector<cv::Mat> &build(size_t cam_id, const cv::Mat &img) {
+    CameraBuffers &buffers = _cameras.at(cam_id);
+    std::lock_guard<std::mutex> lck(buffers.mtx);
+    std::vector<cv::Mat> &pyr = buffers.pyr[1 - buffers.last];
+    for (cv::Mat &level : pyr)
+      release_if_shared(level);
+    cv::buildOpticalFlowPyramid(img, pyr, _win_size, _levels);
+    buffers.img_new = img;
+    return pyr;
+  }
+
+  /**
+   * @brief Makes the new image and pyramid of a camera its last (call once we are done tracking into it)
+   * @param cam_id Id of the camera
+   */
+  void advance(size_t cam_id) {
+    CameraBuffers &buffers = _cameras.at(cam_id);
+    std::lock_guard<std::mutex> lck(buffers.mtx);
+    // If the new image was not written into our buffer, then just point to it
+    if (buffers.img_new.data != buffers.img[1 - buffers.last].data)
+      buffers.img[1 - buffers.last] = buffers.img_new;
+    buffers.img_new = cv::Mat();
+    buffers.last = 1 - buffers.last;
+  }
+
+  /// Last image of a camera
+  const cv::Mat &last_image(size_t cam_id) const { return _cameras.at(cam_id).img[_cameras.at(cam_id).last]; }
+
+  /// Pyramid of the last image of a camera
+  const std::vector<cv::Mat> &last_pyramid(size_t cam_id) const { return _cameras.at(cam_id).pyr[_cameras.at(cam_id).last]; }
+
+  /// Pyramid of the new image of a camera (the last one we built)
+  const std::vector<cv::Mat> &new_pyramid(size_t cam_id) const {
+    return _cameras.at(cam_id).pyr[1 - _cameras.at(cam_id).last];
+  }
+
+  /// Number of bytes of image memory we are holding for all cameras
+  size_t memory_bytes() const {
+    size_t bytes = 0;
+    for (const auto &pair : _cameras) {
+      std::lock_guard<std::mutex> lck(pair.second.mtx);
+      for (int i = 0; i < 2; i++) {
+        bytes += allocated_bytes(pair.second.img[i]);
+        for (const cv::Mat &level : pair.second.pyr[i])
+          bytes += allocated_bytes(level);
+      }
+    }
+    return bytes;
+  }
+
+protected:
+  /// Image and pyramid buffers of a single camera, and which of the two is the last image
+  struct CameraBuffers {
+    mutable std::mutex mtx;
+    cv::Mat img[2];
+    std::vector<cv::Mat> pyr[2];
+    cv::Mat img_new;
+    int last = 0;
+  };
+
+  /// Drops our reference to an image if someone else also has one, so it will be reallocated instead of overwritten
+  static void release_if_shared(cv::Mat &mat) {
+    if (mat.u != nullptr && mat.u->refcount > 1)
+      mat.release();
+  }
+
+  /// Size of the whole allocation an image (or region of one) is in
+  static size_t allocated_bytes(const cv::Mat &mat) {
+    if (mat.empty())
+      return 0;
+    cv::Size whole;
+    cv::Point offset;
+    mat.locateROI(whole, offset);
+    return (size_t)whole.area() * mat.elemSize();
+  }
+
+  /// KLT window size our pyramids are built for
+  cv::Size _win_size;
+
+  /// Number of pyramid levels we build
+  int _levels;
+
+  /// Buffers of each camera
+  std::map<size_t, CameraBuffers> _cameras;
+};
+
+} // namespace ov_core
+
+#endif // OV_CORE_PYRAMID_CACHE_H
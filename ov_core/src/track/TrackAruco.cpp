@@ -155,12 +155,14 @@ void TrackAruco::perform_tracking(double timestamp, const cv::Mat &imgin, size_t
 void TrackAruco::display_active(cv::Mat &img_out, int r1, int g1, int b1, int r2, int g2, int b2) {
 
   // Cache the images to prevent other threads from editing while we viz (which can be slow)
+  // NOTE: the tracker holds the feed mutex while it updates these, so we copy under it
   std::map<size_t, cv::Mat> img_last_cache, img_mask_last_cache;
-  for (auto const &pair : img_last) {
-    img_last_cache.insert({pair.first, pair.second.clone()});
-  }
-  for (auto const &pair : img_mask_last) {
-    img_mask_last_cache.insert({pair.first, pair.second.clone()});
+  for (size_t cam_id = 0; cam_id < mtx_feeds.size(); cam_id++) {
+    std::unique_lock<std::mutex> lck(mtx_feeds.at(cam_id));
+    if (img_last.find(cam_id) == img_last.end())
+      continue;
+    img_last_cache.insert({cam_id, img_last.at(cam_id).clone()});
+    img_mask_last_cache.insert({cam_id, img_mask_last[cam_id].clone()});
   }
 
   // Get the largest width and height
@@ -26,12 +26,16 @@ using namespace ov_core;
 void TrackBase::display_active(cv::Mat &img_out, int r1, int g1, int b1, int r2, int g2, int b2) {
 
   // Cache the images to prevent other threads from editing while we viz (which can be slow)
+  // NOTE: the trackers hold the feed mutex while they update these, so we copy under it
   std::map<size_t, cv::Mat> img_last_cache, img_mask_last_cache;
-  for (auto const &pair : img_last) {
-    img_last_cache.insert({pair.first, pair.second.clone()});
-  }
-  for (auto const &pair : img_mask_last) {
-    img_mask_last_cache.insert({pair.first, pair.second.clone()});
+  std::map<size_t, std::vector<cv::KeyPoint>> pts_last_cache;
+  for (size_t cam_id = 0; cam_id < mtx_feeds.size(); cam_id++) {
+    std::unique_lock<std::mutex> lck(mtx_feeds.at(cam_id));
+    if (img_last.find(cam_id) == img_last.end())
+      continue;
+    img_last_cache.insert({cam_id, img_last.at(cam_id).clone()});
+    img_mask_last_cache.insert({cam_id, img_mask_last[cam_id].clone()});
+    pts_last_cache.insert({cam_id, pts_last[cam_id]});
   }
 
   // Get the largest width and height
@@ -62,8 +66,6 @@ void TrackBase::display_active(cv::Mat &img_out, int r1, int g1, int b1, int r2,
   // Loop through each image, and draw
   int index_cam = 0;
   for (auto const &pair : img_last_cache) {
-    // Lock this image
-    std::unique_lock<std::mutex> lck(mtx_feeds.at(pair.first));
     // select the subset of the image
     cv::Mat img_temp;
     if (image_new)
@@ -71,9 +73,9 @@ void TrackBase::display_active(cv::Mat &img_out, int r1, int g1, int b1, int r2,
     else
       img_temp = img_out(cv::Rect(max_width * index_cam, 0, max_width, max_height));
     // draw, loop through all keypoints
-    for (size_t i = 0; i < pts_last[pair.first].size(); i++) {
+    for (size_t i = 0; i < pts_last_cache[pair.first].size(); i++) {
       // Get bounding pts for our boxes
-      cv::Point2f pt_l = pts_last[pair.first].at(i).pt;
+      cv::Point2f pt_l = pts_last_cache[pair.first].at(i).pt;
       // Draw the extracted points and ID
       cv::circle(img_temp, pt_l, (is_small) ? 1 : 2, cv::Scalar(r1, g1, b1), cv::FILLED);
       // cv::putText(img_out, std::to_string(ids_left_last.at(i)), pt_l, cv::FONT_HERSHEY_SIMPLEX,0.5,cv::Scalar(0,0,255),1,cv::LINE_AA);
@@ -98,13 +100,27 @@ void TrackBase::display_active(cv::Mat &img_out, int r1, int g1, int b1, int r2,
 
 void TrackBase::display_history(cv::Mat &img_out, int r1, int g1, int b1, int r2, int g2, int b2, std::vector<size_t> highlighted) {
 
-  // Cache the images to prevent other threads from editing while we viz (which can be slow)
+  // Cache the images and tracks to prevent other threads from editing while we viz (which can be slow)
+  // NOTE: the trackers hold the feed mutex while they update these, so we copy under it
+  // NOTE: features are copied out of the database, as it could be updated or cleaned up by the tracking thread
   std::map<size_t, cv::Mat> img_last_cache, img_mask_last_cache;
-  for (auto const &pair : img_last) {
-    img_last_cache.insert({pair.first, pair.second.clone()});
-  }
-  for (auto const &pair : img_mask_last) {
-    img_mask_last_cache.insert({pair.first, pair.second.clone()});
+  std::map<size_t, std::vector<cv::KeyPoint>> pts_last_cache;
+  std::map<size_t, std::vector<size_t>> ids_last_cache;
+  std::map<size_t, std::vector<Feature>> feats_last_cache;
+  for (size_t cam_id = 0; cam_id < mtx_feeds.size(); cam_id++) {
+    std::unique_lock<std::mutex> lck(mtx_feeds.at(cam_id));
+    if (img_last.find(cam_id) == img_last.end())
+      continue;
+    img_last_cache.insert({cam_id, img_last.at(cam_id).clone()});
+    img_mask_last_cache.insert({cam_id, img_mask_last[cam_id].clone()});
+    pts_last_cache.insert({cam_id, pts_last[cam_id]});
+    ids_last_cache.insert({cam_id, ids_last[cam_id]});
+    std::vector<Feature> &feats = feats_last_cache[cam_id];
+    for (size_t id : ids_last[cam_id]) {
+      Feature feat;
+      if (database->get_feature_clone(id, feat))
+        feats.push_back(feat);
+    }
   }
 
   // Get the largest width and height
@@ -138,8 +154,6 @@ void TrackBase::display_history(cv::Mat &img_out, int r1, int g1, int b1, int r2
   // Loop through each image, and draw
   int index_cam = 0;
   for (auto const &pair : img_last_cache) {
-    // Lock this image
-    std::unique_lock<std::mutex> lck(mtx_feeds.at(pair.first));
     // select the subset of the image
     cv::Mat img_temp;
     if (image_new)
@@ -147,41 +161,42 @@ void TrackBase::display_history(cv::Mat &img_out, int r1, int g1, int b1, int r2
     else
       img_temp = img_out(cv::Rect(max_width * index_cam, 0, max_width, max_height));
     // draw, loop through all keypoints
-    for (size_t i = 0; i < ids_last[pair.first].size(); i++) {
+    for (size_t i = 0; i < ids_last_cache[pair.first].size(); i++) {
       // If a highlighted point, then put a nice box around it
-      if (std::find(highlighted.begin(), highlighted.end(), ids_last[pair.first].at(i)) != highlighted.end()) {
-        cv::Point2f pt_c = pts_last[pair.first].at(i).pt;
+      if (std::find(highlighted.begin(), highlighted.end(), ids_last_cache[pair.first].at(i)) != highlighted.end()) {
+        cv::Point2f pt_c = pts_last_cache[pair.first].at(i).pt;
         cv::Point2f pt_l_top = cv::Point2f(pt_c.x - ((is_small) ? 3 : 5), pt_c.y - ((is_small) ? 3 : 5));
         cv::Point2f pt_l_bot = cv::Point2f(pt_c.x + ((is_small) ? 3 : 5), pt_c.y + ((is_small) ? 3 : 5));
         cv::rectangle(img_temp, pt_l_top, pt_l_bot, cv::Scalar(0, 255, 0), 1);
         cv::circle(img_temp, pt_c, (is_small) ? 1 : 2, cv::Scalar(0, 255, 0), cv::FILLED);
       }
-      // Get the feature from the database
-      std::shared_ptr<Feature> feat = database->get_feature(ids_last[pair.first].at(i));
-      // Skip if the feature is null
-      if (feat == nullptr || feat->uvs[pair.first].empty() || feat->to_delete)
+    }
+    // draw the history of all features we copied from the database
+    for (Feature &feat : feats_last_cache[pair.first]) {
+      // Skip if the feature has no measurements
+      if (feat.uvs[pair.first].empty() || feat.to_delete)
         continue;
       // Draw the history of this point (start at the last inserted one)
-      for (size_t z = feat->uvs[pair.first].size() - 1; z > 0; z--) {
+      for (size_t z = feat.uvs[pair.first].size() - 1; z > 0; z--) {
         // Check if we have reached the max
-        if (feat->uvs[pair.first].size() - z > maxtracks)
+        if (feat.uvs[pair.first].size() - z > maxtracks)
           break;
         // Calculate what color we are drawing in
-        bool is_stereo = (feat->uvs.size() > 1);
-        int color_r = (is_stereo ? b2 : r2) - (int)((is_stereo ? b1 : r1) / feat->uvs[pair.first].size() * z);
-        int color_g = (is_stereo ? r2 : g2) - (int)((is_stereo ? r1 : g1) / feat->uvs[pair.first].size() * z);
-        int color_b = (is_stereo ? g2 : b2) - (int)((is_stereo ? g1 : b1) / feat->uvs[pair.first].size() * z);
+        bool is_stereo = (feat.uvs.size() > 1);
+        int color_r = (is_stereo ? b2 : r2) - (int)((is_stereo ? b1 : r1) / feat.uvs[pair.first].size() * z);
+        int color_g = (is_stereo ? r2 : g2) - (int)((is_stereo ? r1 : g1) / feat.uvs[pair.first].size() * z);
+        int color_b = (is_stereo ? g2 : b2) - (int)((is_stereo ? g1 : b1) / feat.uvs[pair.first].size() * z);
         // Draw current point
-        cv::Point2f pt_c(feat->uvs[pair.first].at(z)(0), feat->uvs[pair.first].at(z)(1));
+        cv::Point2f pt_c(feat.uvs[pair.first].at(z)(0), feat.uvs[pair.first].at(z)(1));
         cv::circle(img_temp, pt_c, (is_small) ? 1 : 2, cv::Scalar(color_r, color_g, color_b), cv::FILLED);
         // If there is a next point, then display the line from this point to the next
-        if (z + 1 < feat->uvs[pair.first].size()) {
-          cv::Point2f pt_n(feat->uvs[pair.first].at(z + 1)(0), feat->uvs[pair.first].at(z + 1)(1));
+        if (z + 1 < feat.uvs[pair.first].size()) {
+          cv::Point2f pt_n(feat.uvs[pair.first].at(z + 1)(0), feat.uvs[pair.first].at(z + 1)(1));
           cv::line(img_temp, pt_c, pt_n, cv::Scalar(color_r, color_g, color_b));
         }
         // If the first point, display the ID
-        if (z == feat->uvs[pair.first].size() - 1) {
-          // cv::putText(img_out0, std::to_string(feat->featid), pt_c, cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(0, 0, 255), 1,
+        if (z == feat.uvs[pair.first].size() - 1) {
+          // cv::putText(img_out0, std::to_string(feat.featid), pt_c, cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(0, 0, 255), 1,
           // cv::LINE_AA); cv::circle(img_out0, pt_c, 2, cv::Scalar(color,color,255), CV_FILLED);
         }
       }
@@ -158,6 +158,21 @@ public:
   }
 
 protected:
+  /**
+   * @brief Undistorts all keypoints of a camera at once into normalized coordinates
+   * @param cam_id Id of the camera the keypoints are in
+   * @param pts Raw keypoints
+   * @param pts_n Normalized coordinates of each keypoint
+   */
+  void undistort_keypoints(size_t cam_id, const std::vector<cv::KeyPoint> &pts, std::vector<cv::Point2f> &pts_n) {
+    std::vector<cv::Point2f> pts_raw;
+    pts_raw.reserve(pts.size());
+    for (const auto &kpt : pts) {
+      pts_raw.push_back(kpt.pt);
+    }
+    camera_calib.at(cam_id)->undistort_cv(pts_raw, pts_n);
+  }
+
   /// Camera object which has all calibration in it
   std::unordered_map<size_t, std::shared_ptr<CamBase>> camera_calib;
 
@@ -135,10 +135,9 @@ void TrackDescriptor::feed_monocular(const CameraData &message, size_t msg_id) {
   rT4 = boost::posix_time::microsec_clock::local_time();
 
   // Update our feature database, with theses new observations
-  for (size_t i = 0; i < good_left.size(); i++) {
-    cv::Point2f npt_l = camera_calib.at(cam_id)->undistort_cv(good_left.at(i).pt);
-    database->update_feature(good_ids_left.at(i), message.timestamp, cam_id, good_left.at(i).pt.x, good_left.at(i).pt.y, npt_l.x, npt_l.y);
-  }
+  std::vector<cv::Point2f> npts_l;
+  undistort_keypoints(cam_id, good_left, npts_l);
+  database->update_features(good_ids_left, message.timestamp, cam_id, good_left, npts_l);
 
   // Debug info
   // printf("LtoL = %d | good = %d | fromlast = %d\n",(int)matches_ll.size(),(int)good_left.size(),num_tracklast);
@@ -283,18 +282,13 @@ void TrackDescriptor::feed_stereo(const CameraData &message, size_t msg_id_left,
   //===================================================================================
 
   // Update our feature database, with theses new observations
-  for (size_t i = 0; i < good_left.size(); i++) {
-    // Assert that our IDs are the same
-    assert(good_ids_left.at(i) == good_ids_right.at(i));
-    // Try to undistort the point
-    cv::Point2f npt_l = camera_calib.at(cam_id_left)->undistort_cv(good_left.at(i).pt);
-    cv::Point2f npt_r = camera_calib.at(cam_id_right)->undistort_cv(good_right.at(i).pt);
-    // Append to the database
-    database->update_feature(good_ids_left.at(i), message.timestamp, cam_id_left, good_left.at(i).pt.x, good_left.at(i).pt.y, npt_l.x,
-                             npt_l.y);
-    database->update_feature(good_ids_left.at(i), message.timestamp, cam_id_right, good_right.at(i).pt.x, good_right.at(i).pt.y, npt_r.x,
-                             npt_r.y);
-  }
+  // Assert that our IDs are the same
+  assert(good_ids_left == good_ids_right);
+  std::vector<cv::Point2f> npts_l, npts_r;
+  undistort_keypoints(cam_id_left, good_left, npts_l);
+  undistort_keypoints(cam_id_right, good_right, npts_r);
+  database->update_features(good_ids_left, message.timestamp, cam_id_left, good_left, npts_l);
+  database->update_features(good_ids_left, message.timestamp, cam_id_right, good_right, npts_r);
 
   // Debug info
   // printf("LtoL = %d | RtoR = %d | LtoR = %d | good = %d | fromlast = %d\n", (int)matches_ll.size(),
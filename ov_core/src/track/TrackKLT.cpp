@@ -64,14 +64,19 @@ void TrackKLT::feed_monocular(const CameraData &message, size_t msg_id) {
 
   // Histogram equalize
   // 直方图均衡化处理
+  // We equalize into the buffer of the image before the last, so its memory can be reused
   cv::Mat img, mask;
   if (histogram_method == HistogramMethod::HISTOGRAM) {
-    cv::equalizeHist(message.images.at(msg_id), img);
+    cv::Mat &img_eq = pyramids->next_image(cam_id);
+    cv::equalizeHist(message.images.at(msg_id), img_eq);
+    img = img_eq;
   } else if (histogram_method == HistogramMethod::CLAHE) {
     double eq_clip_limit = 10.0;
     cv::Size eq_win_size = cv::Size(8, 8);
     cv::Ptr<cv::CLAHE> clahe = cv::createCLAHE(eq_clip_limit, eq_win_size);
-    clahe->apply(message.images.at(msg_id), img);
+    cv::Mat &img_eq = pyramids->next_image(cam_id);
+    clahe->apply(message.images.at(msg_id), img_eq);
+    img = img_eq;
   } else {
     img = message.images.at(msg_id);
   }
@@ -79,8 +84,7 @@ void TrackKLT::feed_monocular(const CameraData &message, size_t msg_id) {
 
   // Extract the new image pyramid
   // 图像金字塔提取
-  std::vector<cv::Mat> imgpyr;
-  cv::buildOpticalFlowPyramid(img, imgpyr, win_size, pyr_levels);
+  const std::vector<cv::Mat> &imgpyr = pyramids->build(cam_id, img);
   rT2 = boost::posix_time::microsec_clock::local_time();
 
   // If we didn't have any successful tracks last time, just extract this time
@@ -91,29 +95,33 @@ void TrackKLT::feed_monocular(const CameraData &message, size_t msg_id) {
     perform_detection_monocular(imgpyr, mask, pts_last[cam_id], ids_last[cam_id]);
     // Save the current image and pyramid
     img_last[cam_id] = img;
-    img_pyramid_last[cam_id] = imgpyr;
+    pyramids->advance(cam_id);
     img_mask_last[cam_id] = mask;
     return;
   }
 
   // First we should make that the last images have enough features so we can do KLT
   // This will "top-off" our number of tracks so always have a constant number
-  perform_detection_monocular(img_pyramid_last[cam_id], img_mask_last[cam_id], pts_last[cam_id], ids_last[cam_id]);
+  perform_detection_monocular(pyramids->last_pyramid(cam_id), img_mask_last[cam_id], pts_last[cam_id], ids_last[cam_id]);
   rT3 = boost::posix_time::microsec_clock::local_time();
 
   // Our return success masks, and predicted new features
+  // If we know how the camera has rotated, then we can predict where the features will be
   std::vector<uchar> mask_ll;
   std::vector<cv::KeyPoint> pts_left_new = pts_last[cam_id];
+  bool predicted = (msg_id < message.R_lasttocurr.size());
+  if (predicted)
+    predict_points(cam_id, message.R_lasttocurr.at(msg_id), pts_last[cam_id], pts_left_new);
 
   // Lets track temporally
-  perform_matching(img_pyramid_last[cam_id], imgpyr, pts_last[cam_id], pts_left_new, cam_id, cam_id, mask_ll);
+  perform_matching(pyramids->last_pyramid(cam_id), imgpyr, pts_last[cam_id], pts_left_new, cam_id, cam_id, mask_ll, predicted);
   assert(pts_left_new.size() == ids_last[cam_id].size());
   rT4 = boost::posix_time::microsec_clock::local_time();
 
   // If any of our mask is empty, that means we didn't have enough to do ransac, so just return
   if (mask_ll.empty()) {
     img_last[cam_id] = img;
-    img_pyramid_last[cam_id] = imgpyr;
+    pyramids->advance(cam_id);
     img_mask_last[cam_id] = mask;
     pts_last[cam_id].clear();
     ids_last[cam_id].clear();
@@ -143,14 +151,13 @@ void TrackKLT::feed_monocular(const CameraData &message, size_t msg_id) {
   }
 
   // Update our feature database, with theses new observations
-  for (size_t i = 0; i < good_left.size(); i++) {
-    cv::Point2f npt_l = camera_calib.at(cam_id)->undistort_cv(good_left.at(i).pt);
-    database->update_feature(good_ids_left.at(i), message.timestamp, cam_id, good_left.at(i).pt.x, good_left.at(i).pt.y, npt_l.x, npt_l.y);
-  }
+  std::vector<cv::Point2f> npts_l;
+  undistort_keypoints(cam_id, good_left, npts_l);
+  database->update_features(good_ids_left, message.timestamp, cam_id, good_left, npts_l);
 
   // Move forward in time
   img_last[cam_id] = img;
-  img_pyramid_last[cam_id] = imgpyr;
+  pyramids->advance(cam_id);
   img_mask_last[cam_id] = mask;
   pts_last[cam_id] = good_left;
   ids_last[cam_id] = good_ids_left;
@@ -176,16 +183,25 @@ void TrackKLT::feed_stereo(const CameraData &message, size_t msg_id_left, size_t
   std::unique_lock<std::mutex> lck2(mtx_feeds.at(cam_id_right));
 
   // Histogram equalize images
+  // We equalize into the buffers of the images before the last, so their memory can be reused
   cv::Mat img_left, img_right, mask_left, mask_right;
   if (histogram_method == HistogramMethod::HISTOGRAM) {
-    cv::equalizeHist(message.images.at(msg_id_left), img_left);
-    cv::equalizeHist(message.images.at(msg_id_right), img_right);
+    cv::Mat &img_eq_left = pyramids->next_image(cam_id_left);
+    cv::Mat &img_eq_right = pyramids->next_image(cam_id_right);
+    cv::equalizeHist(message.images.at(msg_id_left), img_eq_left);
+    cv::equalizeHist(message.images.at(msg_id_right), img_eq_right);
+    img_left = img_eq_left;
+    img_right = img_eq_right;
   } else if (histogram_method == HistogramMethod::CLAHE) {
     double eq_clip_limit = 10.0;
     cv::Size eq_win_size = cv::Size(8, 8);
     cv::Ptr<cv::CLAHE> clahe = cv::createCLAHE(eq_clip_limit, eq_win_size);
-    clahe->apply(message.images.at(msg_id_left), img_left);
-    clahe->apply(message.images.at(msg_id_right), img_right);
+    cv::Mat &img_eq_left = pyramids->next_image(cam_id_left);
+    cv::Mat &img_eq_right = pyramids->next_image(cam_id_right);
+    clahe->apply(message.images.at(msg_id_left), img_eq_left);
+    clahe->apply(message.images.at(msg_id_right), img_eq_right);
+    img_left = img_eq_left;
+    img_right = img_eq_right;
   } else {
     img_left = message.images.at(msg_id_left);
     img_right = message.images.at(msg_id_right);
@@ -194,13 +210,14 @@ void TrackKLT::feed_stereo(const CameraData &message, size_t msg_id_left, size_t
   mask_right = message.masks.at(msg_id_right);
 
   // Extract image pyramids
-  std::vector<cv::Mat> imgpyr_left, imgpyr_right;
   parallel_for_(cv::Range(0, 2), LambdaBody([&](const cv::Range &range) {
                   for (int i = range.start; i < range.end; i++) {
                     bool is_left = (i == 0);
-                    cv::buildOpticalFlowPyramid(is_left ? img_left : img_right, is_left ? imgpyr_left : imgpyr_right, win_size, pyr_levels);
+                    pyramids->build(is_left ? cam_id_left : cam_id_right, is_left ? img_left : img_right);
                   }
                 }));
+  const std::vector<cv::Mat> &imgpyr_left = pyramids->new_pyramid(cam_id_left);
+  const std::vector<cv::Mat> &imgpyr_right = pyramids->new_pyramid(cam_id_right);
   rT2 = boost::posix_time::microsec_clock::local_time();
 
   // If we didn't have any successful tracks last time, just extract this time
@@ -212,8 +229,8 @@ void TrackKLT::feed_stereo(const CameraData &message, size_t msg_id_left, size_t
     // Save the current image and pyramid
     img_last[cam_id_left] = img_left;
     img_last[cam_id_right] = img_right;
-    img_pyramid_last[cam_id_left] = imgpyr_left;
-    img_pyramid_last[cam_id_right] = imgpyr_right;
+    pyramids->advance(cam_id_left);
+    pyramids->advance(cam_id_right);
     img_mask_last[cam_id_left] = mask_left;
     img_mask_last[cam_id_right] = mask_right;
     return;
@@ -221,24 +238,28 @@ void TrackKLT::feed_stereo(const CameraData &message, size_t msg_id_left, size_t
 
   // First we should make that the last images have enough features so we can do KLT
   // This will "top-off" our number of tracks so always have a constant number
-  perform_detection_stereo(img_pyramid_last[cam_id_left], img_pyramid_last[cam_id_right], img_mask_last[cam_id_left],
+  perform_detection_stereo(pyramids->last_pyramid(cam_id_left), pyramids->last_pyramid(cam_id_right), img_mask_last[cam_id_left],
                            img_mask_last[cam_id_right], cam_id_left, cam_id_right, pts_last[cam_id_left], pts_last[cam_id_right],
                            ids_last[cam_id_left], ids_last[cam_id_right]);
   rT3 = boost::posix_time::microsec_clock::local_time();
 
   // Our return success masks, and predicted new features
+  // If we know how the cameras have rotated, then we can predict where the features will be
   std::vector<uchar> mask_ll, mask_rr;
   std::vector<cv::KeyPoint> pts_left_new = pts_last[cam_id_left];
   std::vector<cv::KeyPoint> pts_right_new = pts_last[cam_id_right];
+  bool predicted = (msg_id_left < message.R_lasttocurr.size() && msg_id_right < message.R_lasttocurr.size());
 
   // Lets track temporally
   parallel_for_(cv::Range(0, 2), LambdaBody([&](const cv::Range &range) {
                   for (int i = range.start; i < range.end; i++) {
                     bool is_left = (i == 0);
-                    perform_matching(img_pyramid_last[is_left ? cam_id_left : cam_id_right], is_left ? imgpyr_left : imgpyr_right,
-                                     pts_last[is_left ? cam_id_left : cam_id_right], is_left ? pts_left_new : pts_right_new,
-                                     is_left ? cam_id_left : cam_id_right, is_left ? cam_id_left : cam_id_right,
-                                     is_left ? mask_ll : mask_rr);
+                    size_t cam_id = is_left ? cam_id_left : cam_id_right;
+                    if (predicted)
+                      predict_points(cam_id, message.R_lasttocurr.at(is_left ? msg_id_left : msg_id_right), pts_last[cam_id],
+                                     is_left ? pts_left_new : pts_right_new);
+                    perform_matching(pyramids->last_pyramid(cam_id), is_left ? imgpyr_left : imgpyr_right, pts_last[cam_id],
+                                     is_left ? pts_left_new : pts_right_new, cam_id, cam_id, is_left ? mask_ll : mask_rr, predicted);
                   }
                 }));
   rT4 = boost::posix_time::microsec_clock::local_time();
@@ -260,8 +281,8 @@ void TrackKLT::feed_stereo(const CameraData &message, size_t msg_id_left, size_t
   if (mask_ll.empty() && mask_rr.empty()) {
     img_last[cam_id_left] = img_left;
     img_last[cam_id_right] = img_right;
-    img_pyramid_last[cam_id_left] = imgpyr_left;
-    img_pyramid_last[cam_id_right] = imgpyr_right;
+    pyramids->advance(cam_id_left);
+    pyramids->advance(cam_id_right);
     img_mask_last[cam_id_left] = mask_left;
     img_mask_last[cam_id_right] = mask_right;
     pts_last[cam_id_left].clear();
@@ -328,22 +349,17 @@ void TrackKLT::feed_stereo(const CameraData &message, size_t msg_id_left, size_t
   }
 
   // Update our feature database, with theses new observations
-  for (size_t i = 0; i < good_left.size(); i++) {
-    cv::Point2f npt_l = camera_calib.at(cam_id_left)->undistort_cv(good_left.at(i).pt);
-    database->update_feature(good_ids_left.at(i), message.timestamp, cam_id_left, good_left.at(i).pt.x, good_left.at(i).pt.y, npt_l.x,
-                             npt_l.y);
-  }
-  for (size_t i = 0; i < good_right.size(); i++) {
-    cv::Point2f npt_r = camera_calib.at(cam_id_right)->undistort_cv(good_right.at(i).pt);
-    database->update_feature(good_ids_right.at(i), message.timestamp, cam_id_right, good_right.at(i).pt.x, good_right.at(i).pt.y, npt_r.x,
-                             npt_r.y);
-  }
+  std::vector<cv::Point2f> npts_l, npts_r;
+  undistort_keypoints(cam_id_left, good_left, npts_l);
+  undistort_keypoints(cam_id_right, good_right, npts_r);
+  database->update_features(good_ids_left, message.timestamp, cam_id_left, good_left, npts_l);
+  database->update_features(good_ids_right, message.timestamp, cam_id_right, good_right, npts_r);
 
   // Move forward in time
   img_last[cam_id_left] = img_left;
   img_last[cam_id_right] = img_right;
-  img_pyramid_last[cam_id_left] = imgpyr_left;
-  img_pyramid_last[cam_id_right] = imgpyr_right;
+  pyramids->advance(cam_id_left);
+  pyramids->advance(cam_id_right);
   img_mask_last[cam_id_left] = mask_left;
   img_mask_last[cam_id_right] = mask_right;
   pts_last[cam_id_left] = good_left;
@@ -412,8 +428,9 @@ void TrackKLT::perform_detection_monocular(const std::vector<cv::Mat> &img0pyr,
 
   // Extract our features (use fast with griding)
   // 划分小网格，在每个小网格并行提取数量均匀的特征点
+  // Only the grid cells which do not have enough tracked features are extracted from
   std::vector<cv::KeyPoint> pts0_ext;
-  Grider_FAST::perform_griding(img0pyr.at(0), mask0, pts0_ext, num_featsneeded, grid_x, grid_y, threshold, true);
+  Grider_FAST::perform_griding(img0pyr.at(0), mask0, pts0, pts0_ext, num_features, num_featsneeded, grid_x, grid_y, threshold, true);
 
   // Now, reject features that are close a current feature
   std::vector<cv::KeyPoint> kpts0_new;
@@ -501,8 +518,9 @@ void TrackKLT::perform_detection_stereo(const std::vector<cv::Mat> &img0pyr, con
   if (num_featsneeded_0 > std::min(75, (int)(0.2 * num_features))) {
 
     // Extract our features (use fast with griding)
+    // Only the grid cells which do not have enough tracked features are extracted from
     std::vector<cv::KeyPoint> pts0_ext;
-    Grider_FAST::perform_griding(img0pyr.at(0), mask0, pts0_ext, num_featsneeded_0, grid_x, grid_y, threshold, true);
+    Grider_FAST::perform_griding(img0pyr.at(0), mask0, pts0, pts0_ext, num_features, num_featsneeded_0, grid_x, grid_y, threshold, true);
 
     // Now, reject features that are close a current feature
     std::vector<cv::KeyPoint> kpts0_new;
@@ -635,8 +653,9 @@ void TrackKLT::perform_detection_stereo(const std::vector<cv::Mat> &img0pyr, con
   if (num_featsneeded_1 > std::min(75, (int)(0.2 * num_features))) {
 
     // Extract our features (use fast with griding)
+    // Only the grid cells which do not have enough tracked features are extracted from
     std::vector<cv::KeyPoint> pts1_ext;
-    Grider_FAST::perform_griding(img1pyr.at(0), mask1, pts1_ext, num_featsneeded_1, grid_x, grid_y, threshold, true);
+    Grider_FAST::perform_griding(img1pyr.at(0), mask1, pts1, pts1_ext, num_features, num_featsneeded_1, grid_x, grid_y, threshold, true);
 
     // Now, reject features that are close a current feature
     for (auto &kpt : pts1_ext) {
@@ -658,7 +677,7 @@ void TrackKLT::perform_detection_stereo(const std::vector<cv::Mat> &img0pyr, con
 }
 
 void TrackKLT::perform_matching(const std::vector<cv::Mat> &img0pyr, const std::vector<cv::Mat> &img1pyr, std::vector<cv::KeyPoint> &kpts0,
-                                std::vector<cv::KeyPoint> &kpts1, size_t id0, size_t id1, std::vector<uchar> &mask_out) {
+                                std::vector<cv::KeyPoint> &kpts1, size_t id0, size_t id1, std::vector<uchar> &mask_out, bool predicted) {
 
   // We must have equal vectors
   assert(kpts0.size() == kpts1.size());
@@ -685,18 +704,19 @@ void TrackKLT::perform_matching(const std::vector<cv::Mat> &img0pyr, const std::
   // Now do KLT tracking to get the valid new points
   std::vector<uchar> mask_klt;
   std::vector<float> error;
+  // If our initial guess was predicted, then it should be close and we do not need to search as far
   // LK光流跟踪
-  cv::TermCriteria term_crit = cv::TermCriteria(cv::TermCriteria::COUNT + cv::TermCriteria::EPS, 20, 0.01);
-  cv::calcOpticalFlowPyrLK(img0pyr, img1pyr, pts0, pts1, mask_klt, error, win_size, pyr_levels, term_crit, cv::OPTFLOW_USE_INITIAL_FLOW);
+  int levels = (predicted) ? pyr_levels_predicted : pyr_levels;
+  int iters = (predicted) ? max_iters_predicted : max_iters;
+  cv::TermCriteria term_crit = cv::TermCriteria(cv::TermCriteria::COUNT + cv::TermCriteria::EPS, iters, 0.01);
+  cv::calcOpticalFlowPyrLK(img0pyr, img1pyr, pts0, pts1, mask_klt, error, win_size, levels, term_crit, cv::OPTFLOW_USE_INITIAL_FLOW);
 
   // Normalize these points, so we can then do ransac
   // We don't want to do ransac on distorted image uvs since the mapping is nonlinear
   // 特征点去畸变
   std::vector<cv::Point2f> pts0_n, pts1_n;
-  for (size_t i = 0; i < pts0.size(); i++) {
-    pts0_n.push_back(camera_calib.at(id0)->undistort_cv(pts0.at(i)));
-    pts1_n.push_back(camera_calib.at(id1)->undistort_cv(pts1.at(i)));
-  }
+  camera_calib.at(id0)->undistort_cv(pts0, pts0_n);
+  camera_calib.at(id1)->undistort_cv(pts1, pts1_n);
 
   // Do RANSAC outlier rejection (note since we normalized the max pixel error is now in the normalized cords)
   std::vector<uchar> mask_rsc;
@@ -718,3 +738,27 @@ void TrackKLT::perform_matching(const std::vector<cv::Mat> &img0pyr, const std::
     kpts1.at(i).pt = pts1.at(i);
   }
 }
+
+void TrackKLT::predict_points(size_t cam_id, const Eigen::Matrix3d &R_lasttocurr, const std::vector<cv::KeyPoint> &pts_last,
+                              std::vector<cv::KeyPoint> &pts_pred) {
+
+  // Start from the last locations
+  pts_pred = pts_last;
+  if (pts_last.empty())
+    return;
+
+  // Get the bearing of each feature in the last image
+  std::vector<cv::Point2f> pts, pts_n;
+  for (size_t i = 0; i < pts_last.size(); i++)
+    pts.push_back(pts_last.at(i).pt);
+  camera_calib.at(cam_id)->undistort_cv(pts, pts_n);
+
+  // Rotate into the new camera frame, and project back into the image
+  Eigen::Matrix3f R = R_lasttocurr.cast<float>();
+  for (size_t i = 0; i < pts_n.size(); i++) {
+    Eigen::Vector3f bearing = R * Eigen::Vector3f(pts_n.at(i).x, pts_n.at(i).y, 1.0f);
+    if (bearing(2) < 0.1f)
+      continue;
+    pts_pred.at(i).pt = camera_calib.at(cam_id)->distort_cv(cv::Point2f(bearing(0) / bearing(2), bearing(1) / bearing(2)));
+  }
+}
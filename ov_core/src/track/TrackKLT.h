@@ -22,6 +22,7 @@
 #ifndef OV_CORE_TRACK_KLT_H
 #define OV_CORE_TRACK_KLT_H
 
+#include "PyramidCache.h"
 #include "TrackBase.h"
 
 namespace ov_core {
@@ -54,7 +55,11 @@ public:
   explicit TrackKLT(std::unordered_map<size_t, std::shared_ptr<CamBase>> cameras, int numfeats, int numaruco, bool binocular,
                     HistogramMethod histmethod, int fast_threshold, int gridx, int gridy, int minpxdist)
       : TrackBase(cameras, numfeats, numaruco, binocular, histmethod), threshold(fast_threshold), grid_x(gridx), grid_y(gridy),
-        min_px_dist(minpxdist) {}
+        min_px_dist(minpxdist) {
+    pyramids = std::make_shared<PyramidCache>(win_size, pyr_levels);
+    for (const auto &cam : cameras)
+      pyramids->add_camera(cam.first);
+  }
 
   /**
    * @brief Process a new image
@@ -62,6 +67,24 @@ public:
    */
   void feed_new_camera(const CameraData &message);
 
+  /**
+   * @brief Sets the KLT parameters we use for temporal tracking when we are given the camera rotation between images.
+   *
+   * If the new image has the rotation of its camera since the last image (CameraData::R_lasttocurr), we warp the last
+   * features through this rotation to predict where they will be in the new image.
+   * Since this initial guess is normally close to the true location, fewer pyramid levels and iterations are needed.
+   *
+   * @param levels Number of pyramid levels to track with (should not be more than the pyramid we build)
+   * @param max_iters Max number of KLT iterations on each pyramid level
+   */
+  void set_prediction_params(int levels, int max_iters) {
+    pyr_levels_predicted = std::min(levels, pyr_levels);
+    max_iters_predicted = max_iters;
+  }
+
+  /// Get the image and pyramid buffers of our cameras (e.g. for their memory footprint)
+  std::shared_ptr<PyramidCache> get_pyramid_cache() { return pyramids; }
+
 protected:
   /**
    * @brief Process a new monocular image
@@ -127,9 +150,25 @@ protected:
    * This will track features from the first image into the second image.
    * The two point vectors will be of equal size, but the mask_out variable will specify which points are good or bad.
    * If the second vector is non-empty, it will be used as an initial guess of where the keypoints are in the second image.
+   * If this guess was predicted (see predict_points()) we track with our smaller number of pyramid levels and iterations.
    */
   void perform_matching(const std::vector<cv::Mat> &img0pyr, const std::vector<cv::Mat> &img1pyr, std::vector<cv::KeyPoint> &pts0,
-                        std::vector<cv::KeyPoint> &pts1, size_t id0, size_t id1, std::vector<uchar> &mask_out);
+                        std::vector<cv::KeyPoint> &pts1, size_t id0, size_t id1, std::vector<uchar> &mask_out, bool predicted = false);
+
+  /**
+   * @brief Predicts where features will be in a new image given the rotation of the camera between the two images.
+   *
+   * We undistort each point, rotate its bearing, and then distort it back into the new image.
+   * This is the rotation-only homography K*R*K^-1 for distorted cameras, thus the translation of the camera is ignored.
+   * Points which would be rotated behind the camera are kept at their last location.
+   *
+   * @param cam_id Camera the features are in
+   * @param R_lasttocurr Rotation from the last to the new camera frame
+   * @param pts_last Features in the last image
+   * @param pts_pred Predicted location of each feature in the new image
+   */
+  void predict_points(size_t cam_id, const Eigen::Matrix3d &R_lasttocurr, const std::vector<cv::KeyPoint> &pts_last,
+                      std::vector<cv::KeyPoint> &pts_pred);
 
   // Parameters for our FAST grid detector
   int threshold;
@@ -143,8 +182,15 @@ protected:
   int pyr_levels = 3;
   cv::Size win_size = cv::Size(20, 20);
 
-  // Last set of image pyramids
-  std::map<size_t, std::vector<cv::Mat>> img_pyramid_last;
+  // Max number of KLT iterations
+  int max_iters = 20;
+
+  // Pyramid levels and iterations we use if we have predicted the tracks
+  int pyr_levels_predicted = 2;
+  int max_iters_predicted = 10;
+
+  // Last and new images and pyramids of each camera
+  std::shared_ptr<PyramidCache> pyramids;
 };
 
 } // namespace ov_core
@@ -46,7 +46,7 @@ public:
     _ba = std::shared_ptr<Vec>(new Vec(3));
 
     // Set our default state value
-    Eigen::VectorXd imu0 = Eigen::VectorXd::Zero(16, 1);
+    Eigen::Matrix<double, 16, 1> imu0 = Eigen::Matrix<double, 16, 1>::Zero();
     imu0(3) = 1.0;
     set_value_internal(imu0);
     set_fej_internal(imu0);
@@ -75,7 +75,7 @@ public:
    *
    * @param dx 15 DOF vector encoding update using the following order (q, p, v, bg, ba)
    */
-  void update(const Eigen::VectorXd &dx) override {
+  void update(const Eigen::Ref<const Eigen::VectorXd> &dx) override {
 
     assert(dx.rows() == _size);
 
@@ -99,13 +99,13 @@ public:
    * @brief Sets the value of the estimate
    * @param new_value New value we should set
    */
-  void set_value(const Eigen::MatrixXd &new_value) override { set_value_internal(new_value); }
+  void set_value(const Eigen::Ref<const Eigen::MatrixXd> &new_value) override { set_value_internal(new_value); }
 
   /**
    * @brief Sets the value of the first estimate
    * @param new_value New value we should set
    */
-  void set_fej(const Eigen::MatrixXd &new_value) override { set_fej_internal(new_value); }
+  void set_fej(const Eigen::Ref<const Eigen::MatrixXd> &new_value) override { set_fej_internal(new_value); }
 
   std::shared_ptr<Type> clone() override {
     auto Clone = std::shared_ptr<Type>(new IMU());
@@ -130,10 +130,10 @@ public:
   }
 
   /// Rotation access
-  Eigen::Matrix<double, 3, 3> Rot() const { return _pose->Rot(); }
+  const Eigen::Matrix<double, 3, 3> &Rot() const { return _pose->Rot(); }
 
   /// FEJ Rotation access
-  Eigen::Matrix<double, 3, 3> Rot_fej() const { return _pose->Rot_fej(); }
+  const Eigen::Matrix<double, 3, 3> &Rot_fej() const { return _pose->Rot_fej(); }
 
   /// Rotation access quaternion
   Eigen::Matrix<double, 4, 1> quat() const { return _pose->quat(); }
@@ -200,7 +200,7 @@ protected:
    * @brief Sets the value of the estimate
    * @param new_value New value we should set
    */
-  void set_value_internal(const Eigen::MatrixXd &new_value) {
+  void set_value_internal(const Eigen::Ref<const Eigen::MatrixXd> &new_value) {
 
     assert(new_value.rows() == 16);
     assert(new_value.cols() == 1);
@@ -217,7 +217,7 @@ protected:
    * @brief Sets the value of the first estimate
    * @param new_value New value we should set
    */
-  void set_fej_internal(const Eigen::MatrixXd &new_value) {
+  void set_fej_internal(const Eigen::Ref<const Eigen::MatrixXd> &new_value) {
 
     assert(new_value.rows() == 16);
     assert(new_value.cols() == 1);
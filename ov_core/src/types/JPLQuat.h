@@ -58,7 +58,7 @@ public:
    *
    * @param dx Axis-angle representation of the perturbing quaternion
    */
-  void update(const Eigen::VectorXd &dx) override {
+  void update(const Eigen::Ref<const Eigen::VectorXd> &dx) override {
 
     assert(dx.rows() == _size);
 
@@ -75,13 +75,13 @@ public:
    * @brief Sets the value of the estimate and recomputes the internal rotation matrix
    * @param new_value New value for the quaternion estimate
    */
-  void set_value(const Eigen::MatrixXd &new_value) override { set_value_internal(new_value); }
+  void set_value(const Eigen::Ref<const Eigen::MatrixXd> &new_value) override { set_value_internal(new_value); }
 
   /**
    * @brief Sets the fej value and recomputes the fej rotation matrix
    * @param new_value New value for the quaternion estimate
    */
-  void set_fej(const Eigen::MatrixXd &new_value) override { set_fej_internal(new_value); }
+  void set_fej(const Eigen::Ref<const Eigen::MatrixXd> &new_value) override { set_fej_internal(new_value); }
 
   std::shared_ptr<Type> clone() override {
     auto Clone = std::shared_ptr<JPLQuat>(new JPLQuat());
@@ -91,10 +91,10 @@ public:
   }
 
   /// Rotation access
-  Eigen::Matrix<double, 3, 3> Rot() const { return _R; }
+  const Eigen::Matrix<double, 3, 3> &Rot() const { return _R; }
 
   /// FEJ Rotation access
-  Eigen::Matrix<double, 3, 3> Rot_fej() const { return _Rfej; }
+  const Eigen::Matrix<double, 3, 3> &Rot_fej() const { return _Rfej; }
 
 protected:
   // Stores the rotation
@@ -107,7 +107,7 @@ protected:
    * @brief Sets the value of the estimate and recomputes the internal rotation matrix
    * @param new_value New value for the quaternion estimate
    */
-  void set_value_internal(const Eigen::MatrixXd &new_value) {
+  void set_value_internal(const Eigen::Ref<const Eigen::MatrixXd> &new_value) {
 
     assert(new_value.rows() == 4);
     assert(new_value.cols() == 1);
@@ -122,7 +122,7 @@ protected:
    * @brief Sets the fej value and recomputes the fej rotation matrix
    * @param new_value New value for the quaternion estimate
    */
-  void set_fej_internal(const Eigen::MatrixXd &new_value) {
+  void set_fej_internal(const Eigen::Ref<const Eigen::MatrixXd> &new_value) {
 
     assert(new_value.rows() == 4);
     assert(new_value.cols() == 1);
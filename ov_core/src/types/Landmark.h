@@ -73,10 +73,11 @@ public:
    * We want to selectively update the FEJ value if we are using an anchored representation.
    * @param dx Additive error state correction
    */
-  void update(const Eigen::VectorXd &dx) override {
+  void update(const Eigen::Ref<const Eigen::VectorXd> &dx) override {
     // Update estimate
     assert(dx.rows() == _size);
-    set_value(_value + dx);
+    Storage newX = _value + dx;
+    set_value(newX);
     // Ensure we are not near zero in the z-direction
     if (LandmarkRepresentation::is_relative_representation(_feat_representation) && _value(_value.rows() - 1) < 1e-8) {
       printf(YELLOW "WARNING DEPTH %.8f BECAME CLOSE TO ZERO IN UPDATE!!!\n" RESET, _value(_value.rows() - 1));
@@ -71,7 +71,7 @@ public:
    *
    * @param dx Correction vector (orientation then position)
    */
-  void update(const Eigen::VectorXd &dx) override {
+  void update(const Eigen::Ref<const Eigen::VectorXd> &dx) override {
 
     assert(dx.rows() == _size);
 
@@ -94,13 +94,13 @@ public:
    * @brief Sets the value of the estimate
    * @param new_value New value we should set
    */
-  void set_value(const Eigen::MatrixXd &new_value) override { set_value_internal(new_value); }
+  void set_value(const Eigen::Ref<const Eigen::MatrixXd> &new_value) override { set_value_internal(new_value); }
 
   /**
    * @brief Sets the value of the first estimate
    * @param new_value New value we should set
    */
-  void set_fej(const Eigen::MatrixXd &new_value) override { set_fej_internal(new_value); }
+  void set_fej(const Eigen::Ref<const Eigen::MatrixXd> &new_value) override { set_fej_internal(new_value); }
 
   std::shared_ptr<Type> clone() override {
     auto Clone = std::shared_ptr<PoseJPL>(new PoseJPL());
@@ -119,13 +119,10 @@ public:
   }
 
   /// Rotation access
-  Eigen::Matrix<double, 3, 3> Rot() const { return _q->Rot(); }
+  const Eigen::Matrix<double, 3, 3> &Rot() const { return _q->Rot(); }
 
   /// FEJ Rotation access
-  Eigen::Matrix<double, 3, 3> Rot_fej() const {
-    return _q->Rot_fej();
-    ;
-  }
+  const Eigen::Matrix<double, 3, 3> &Rot_fej() const { return _q->Rot_fej(); }
 
   /// Rotation access as quaternion
   Eigen::Matrix<double, 4, 1> quat() const { return _q->value(); }
@@ -156,7 +153,7 @@ protected:
    * @brief Sets the value of the estimate
    * @param new_value New value we should set
    */
-  void set_value_internal(const Eigen::MatrixXd &new_value) {
+  void set_value_internal(const Eigen::Ref<const Eigen::MatrixXd> &new_value) {
 
     assert(new_value.rows() == 7);
     assert(new_value.cols() == 1);
@@ -174,7 +171,7 @@ protected:
    * @brief Sets the value of the first estimate
    * @param new_value New value we should set
    */
-  void set_fej_internal(const Eigen::MatrixXd &new_value) {
+  void set_fej_internal(const Eigen::Ref<const Eigen::MatrixXd> &new_value) {
 
     assert(new_value.rows() == 7);
     assert(new_value.cols() == 1);
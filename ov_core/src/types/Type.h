@@ -37,6 +37,15 @@ namespace ov_type {
 class Type {
 
 public:
+  /**
+   * @brief Storage used for estimates and first-estimates.
+   *
+   * All our variables are small vectors, thus we use a bounded size which is stored inline and never allocates.
+   * This makes accessors and updates, which are called thousands of times per update, allocation free.
+   * It keeps a runtime size so variables such as Vec can still be created of any dimension up to this bound.
+   */
+  typedef Eigen::Matrix<double, Eigen::Dynamic, 1, Eigen::ColMajor, 16, 1> Storage;
+
   /**
    * @brief Default constructor for our Type
    *
@@ -71,23 +80,23 @@ public:
    *
    * @param dx Perturbation used to update the variable through a defined "boxplus" operation
    */
-  virtual void update(const Eigen::VectorXd &dx) = 0;
+  virtual void update(const Eigen::Ref<const Eigen::VectorXd> &dx) = 0;
 
   /**
    * @brief Access variable's estimate
    */
-  virtual const Eigen::MatrixXd &value() const { return _value; }
+  virtual const Storage &value() const { return _value; }
 
   /**
    * @brief Access variable's first-estimate
    */
-  virtual const Eigen::MatrixXd &fej() const { return _fej; }
+  virtual const Storage &fej() const { return _fej; }
 
   /**
    * @brief Overwrite value of state's estimate
    * @param new_value New value that will overwrite state's value
    */
-  virtual void set_value(const Eigen::MatrixXd &new_value) {
+  virtual void set_value(const Eigen::Ref<const Eigen::MatrixXd> &new_value) {
     assert(_value.rows() == new_value.rows());
     assert(_value.cols() == new_value.cols());
     _value = new_value;
@@ -97,7 +106,7 @@ public:
    * @brief Overwrite value of first-estimate
    * @param new_value New value that will overwrite state's fej
    */
-  virtual void set_fej(const Eigen::MatrixXd &new_value) {
+  virtual void set_fej(const Eigen::Ref<const Eigen::MatrixXd> &new_value) {
     assert(_fej.rows() == new_value.rows());
     assert(_fej.cols() == new_value.cols());
     _fej = new_value;
@@ -120,10 +129,10 @@ public:
 
 protected:
   /// First-estimate
-  Eigen::MatrixXd _fej;
+  Storage _fej;
 
   /// Current best estimate
-  Eigen::MatrixXd _value;
+  Storage _value;
 
   /// Location of error state in covariance
   int _id = -1;
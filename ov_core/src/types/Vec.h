@@ -37,8 +37,9 @@ public:
    * @param dim Size of the vector (will be same as error state)
    */
   Vec(int dim) : Type(dim) {
-    _value = Eigen::VectorXd::Zero(dim);
-    _fej = Eigen::VectorXd::Zero(dim);
+    assert(dim <= Storage::MaxRowsAtCompileTime);
+    _value = Storage::Zero(dim);
+    _fej = Storage::Zero(dim);
   }
 
   ~Vec() {}
@@ -47,9 +48,10 @@ public:
    * @brief Implements the update operation through standard vector addition
    * @param dx Additive error state correction
    */
-  void update(const Eigen::VectorXd &dx) override {
+  void update(const Eigen::Ref<const Eigen::VectorXd> &dx) override {
     assert(dx.rows() == _size);
-    set_value(_value + dx);
+    Storage newX = _value + dx;
+    set_value(newX);
   }
 
   /**
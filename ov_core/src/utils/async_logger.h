@@ -0,0 +1,226 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2021 Patrick Geneva
+ * Copyright (C) 2021 Guoquan Huang
+ * Copyright (C) 2021 OpenVINS Contributors
+ * Copyright (C) 2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OV_CORE_ASYNC_LOGGER_H
+#define OV_CORE_ASYNC_LOGGER_H
+
+#include <algorithm>
+#include <atomic>
+#include <boost/filesystem.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "utils/colors.h"
+
+namespace ov_core {
+
+/**
+ * @brief Writes text lines to file from a background thread.
+ *
+ * Lines are formatted (printf style) directly into a fixed size slot of a lock-free single producer ring buffer.
+ * Thus logging from the estimator thread never waits on the disk, allocates, or takes a lock.
+ * Our thread wakes up periodically and writes all lines it has in a single batch.
+ * If the ring buffer is full (the disk can not keep up) new lines are dropped and counted, instead of blocking the producer.
+ *
+ * Files are rotated once they reach a max size, where the first file is "<name>.<ext>" and the following are "<name>.1.<ext>" etc.
+ * Only the newest max number of files are kept, and the header (if set) is written at the top of each.
+ *
+ * Only a single thread should call log(), while any thread can create and destroy the logger.
+ */
+class AsyncLogger {
+
+public:
+  /// Max number of characters in a single line (longer lines are truncated)
+  static const size_t LINE_SIZE = 256;
+
+  /**
+   * @brief Default constructor, will create the directory and open our first file
+   * @param directory Directory the files will be in
+   * @param name Name of the files (without extension)
+   * @param extension Extension of the files (e.g. "txt" or "csv", empty for none)
+   * @param header Line written at the top of each file (empty for none)
+   * @param max_file_bytes Size a file can be before we rotate to a new one (zero to never rotate)
+   * @param max_files Max number of files we keep (zero to keep all)
+   * @param capacity Number of lines our ring buffer can hold (rounded up to a power of two)
+   */
+  AsyncLogger(const std::string &directory, const std::string &name, const std::string &extension = "txt", const std::string &header = "",
+              size_t max_file_bytes = 0, size_t max_files = 0, size_t capacity = 4096)
+      : _directory(directory), _name(name), _extension(extension), _header(header), _max_file_bytes(max_file_bytes),
+        _max_files(max_files) {
+    size_t size = 2;
+    while (size < capacity)
+      size *= 2;
+    _slots.resize(size);
+    boost::filesystem::create_directories(_directory);
+    open_file();
+    _thread = std::thread(&AsyncLogger::run, this);
+  }
+
+  /// Destructor, will write any remaining lines and close our file
+  ~AsyncLogger() {
+    {
+      std::lock_guard<std::mutex> lck(_mtx);
+      _running = false;
+    }
+    _cv.notify_all();
+    _thread.join();
+    if (_file != nullptr)
+      std::fclose(_file);
+    if (_dropped > 0)
+      printf(YELLOW "[LOG]: dropped %zu lines for %s since we could not write them fast enough\n" RESET, (size_t)_dropped, _name.c_str());
+  }
+
+  AsyncLogger(const AsyncLogger &) = delete;
+  AsyncLogger &operator=(const AsyncLogger &) = delete;
+
+  /**
+   * @brief Appends a line to our file (a newline is added at the end)
+   * @param format printf style format of the line
+   * @return False if our buffer was full and the line was dropped
+   */
+  bool log(const char *format, ...) __attribute__((format(printf, 2, 3))) {
+    size_t head = _head.load(std::memory_order_relaxed);
+    if (head - _tail.load(std::memory_order_acquire) >= _slots.size()) {
+      _dropped++;
+      return false;
+    }
+    Slot &slot = _slots[head & (_slots.size() - 1)];
+    va_list args;
+    va_start(args, format);
+    int length = std::vsnprintf(slot.data, LINE_SIZE - 1, format, args);
+    va_end(args);
+    slot.length = (length < 0) ? 0 : std::min((size_t)length, LINE_SIZE - 2);
+    slot.data[slot.length++] = '\n';
+    _head.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  /// Number of lines we have dropped since our buffer was full
+  size_t num_dropped() const { return _dropped; }
+
+  /// If we were able to open our file
+  bool is_open() const { return _file != nullptr; }
+
+protected:
+  /// A single formatted line
+  struct Slot {
+    char data[LINE_SIZE];
+    size_t length = 0;
+  };
+
+  /// Path of a file given its index (e.g. name.txt, name.1.txt, or name, name.1 if we have no extension)
+  std::string file_path(size_t index) const {
+    std::string file = (index == 0) ? _name : _name + "." + std::to_string(index);
+    if (!_extension.empty())
+      file += "." + _extension;
+    return (boost::filesystem::path(_directory) / file).string();
+  }
+
+  /// Opens our current file (and removes the oldest one if we have too many)
+  void open_file() {
+    _file = std::fopen(file_path(_file_index).c_str(), "w");
+    _file_bytes = 0;
+    if (_file == nullptr) {
+      printf(RED "[LOG]: unable to open %s for writing!\n" RESET, file_path(_file_index).c_str());
+      return;
+    }
+    if (_max_files > 0 && _file_index >= _max_files)
+      boost::filesystem::remove(file_path(_file_index - _max_files));
+    if (!_header.empty()) {
+      std::fprintf(_file, "%s\n", _header.c_str());
+      _file_bytes += _header.size() + 1;
+    }
+  }
+
+  /// Writes all lines in our buffer to file in a single batch
+  void write_lines() {
+    size_t tail = _tail.load(std::memory_order_relaxed);
+    size_t head = _head.load(std::memory_order_acquire);
+    if (tail == head)
+      return;
+    _batch.clear();
+    for (; tail != head; tail++) {
+      const Slot &slot = _slots[tail & (_slots.size() - 1)];
+      _batch.append(slot.data, slot.length);
+    }
+    _tail.store(tail, std::memory_order_release);
+    if (_file == nullptr)
+      return;
+    std::fwrite(_batch.data(), 1, _batch.size(), _file);
+    std::fflush(_file);
+    _file_bytes += _batch.size();
+    if (_max_file_bytes > 0 && _file_bytes >= _max_file_bytes) {
+      std::fclose(_file);
+      _file_index++;
+      open_file();
+    }
+  }
+
+  /// Main loop of our thread, writes our lines every so often till we are stopped
+  void run() {
+    std::unique_lock<std::mutex> lck(_mtx);
+    while (_running) {
+      _cv.wait_for(lck, std::chrono::milliseconds(100), [this] { return !_running; });
+      lck.unlock();
+      write_lines();
+      lck.lock();
+    }
+    write_lines();
+  }
+
+  /// Where and how our files are named
+  std::string _directory, _name, _extension, _header;
+
+  /// Size a file can be before we rotate, and max number of files to keep
+  size_t _max_file_bytes, _max_files;
+
+  /// Current file, its index, and how many bytes we have written to it
+  FILE *_file = nullptr;
+  size_t _file_index = 0;
+  size_t _file_bytes = 0;
+
+  /// Ring buffer of lines, and the next slot to write (head) and read (tail)
+  std::vector<Slot> _slots;
+  std::atomic<size_t> _head{0};
+  std::atomic<size_t> _tail{0};
+
+  /// Number of lines we have dropped
+  std::atomic<size_t> _dropped{0};
+
+  /// Lines we are writing to file in our current batch
+  std::string _batch;
+
+  /// Our writing thread, and if it should keep running
+  std::thread _thread;
+  std::mutex _mtx;
+  std::condition_variable _cv;
+  bool _running = true;
+};
+
+} // namespace ov_core
+
+#endif // OV_CORE_ASYNC_LOGGER_H
@@ -0,0 +1,192 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2021 Patrick Geneva
+ * Copyright (C) 2021 Guoquan Huang
+ * Copyright (C) 2021 OpenVINS Contributors
+ * Copyright (C) 2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OV_CORE_CAMERA_MAP_H
+#define OV_CORE_CAMERA_MAP_H
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace ov_core {
+
+/**
+ * @brief Small map from camera ID to a value, for the per camera information of a feature.
+ *
+ * Features are normally only seen from one or two cameras, so a hash map per feature is mostly overhead.
+ * This stores its entries sorted by camera ID in a flat array, which for up to two cameras is kept inside of this object.
+ * Thus for mono and stereo creating a feature and adding cameras to it does not allocate anything.
+ * If more cameras are added, all entries are moved into a heap array.
+ *
+ * This has the parts of the std::unordered_map interface we use (at, [], find, erase, and iterating over std::pair entries).
+ * Note that iterators and references are invalidated when adding or erasing cameras.
+ */
+template <typename T> class CameraMap {
+
+public:
+  typedef std::pair<size_t, T> value_type;
+  typedef value_type *iterator;
+  typedef const value_type *const_iterator;
+
+  /// Number of cameras we can store without allocating
+  static const size_t INLINE_SIZE = 2;
+
+  CameraMap() {}
+
+  CameraMap(const CameraMap &other) = default;
+
+  CameraMap &operator=(const CameraMap &other) = default;
+
+  CameraMap(CameraMap &&other) { *this = std::move(other); }
+
+  CameraMap &operator=(CameraMap &&other) {
+    if (this == &other)
+      return *this;
+    for (size_t i = 0; i < INLINE_SIZE; i++)
+      _inline[i] = std::move(other._inline[i]);
+    _heap = std::move(other._heap);
+    _size = other._size;
+    other.clear();
+    return *this;
+  }
+
+  iterator begin() { return data(); }
+  iterator end() { return data() + _size; }
+  const_iterator begin() const { return data(); }
+  const_iterator end() const { return data() + _size; }
+
+  /// Number of cameras we have
+  size_t size() const { return _size; }
+
+  /// If we do not have any cameras
+  bool empty() const { return _size == 0; }
+
+  /// Entry of a camera, or end() if we do not have it
+  iterator find(size_t cam_id) {
+    iterator it = lower_bound(cam_id);
+    return (it != end() && it->first == cam_id) ? it : end();
+  }
+  const_iterator find(size_t cam_id) const {
+    const_iterator it = lower_bound(cam_id);
+    return (it != end() && it->first == cam_id) ? it : end();
+  }
+
+  /// Number of entries for this camera (zero or one)
+  size_t count(size_t cam_id) const { return (find(cam_id) != end()) ? 1 : 0; }
+
+  /// Value of a camera, throws std::out_of_range if we do not have it
+  T &at(size_t cam_id) {
+    iterator it = find(cam_id);
+    if (it == end())
+      throw std::out_of_range("CameraMap::at(): camera not found");
+    return it->second;
+  }
+  const T &at(size_t cam_id) const {
+    const_iterator it = find(cam_id);
+    if (it == end())
+      throw std::out_of_range("CameraMap::at(): camera not found");
+    return it->second;
+  }
+
+  /// Value of a camera, will insert a default value if we do not have it
+  T &operator[](size_t cam_id) {
+    iterator it = find(cam_id);
+    if (it != end())
+      return it->second;
+    return insert_sorted(cam_id);
+  }
+
+  /// Removes a camera, returning the entry after it
+  iterator erase(iterator pos) {
+    size_t idx = pos - begin();
+    std::move(pos + 1, end(), pos);
+    _size--;
+    data()[_size].second = T();
+    return begin() + idx;
+  }
+
+  /// Removes a camera if we have it, returning the number removed
+  size_t erase(size_t cam_id) {
+    iterator it = find(cam_id);
+    if (it == end())
+      return 0;
+    erase(it);
+    return 1;
+  }
+
+  /// Removes all cameras
+  void clear() {
+    for (size_t i = 0; i < INLINE_SIZE; i++)
+      _inline[i].second = T();
+    std::vector<value_type>().swap(_heap);
+    _size = 0;
+  }
+
+protected:
+  /// Our entries, either in our inline array or on the heap if we have too many
+  value_type *data() { return _heap.empty() ? _inline : _heap.data(); }
+  const value_type *data() const { return _heap.empty() ? _inline : _heap.data(); }
+
+  /// First entry with a camera ID not less than the given
+  iterator lower_bound(size_t cam_id) {
+    return std::lower_bound(begin(), end(), cam_id, [](const value_type &pair, size_t id) { return pair.first < id; });
+  }
+  const_iterator lower_bound(size_t cam_id) const {
+    return std::lower_bound(begin(), end(), cam_id, [](const value_type &pair, size_t id) { return pair.first < id; });
+  }
+
+  /// Inserts a default value for a camera we do not have, keeping our entries sorted
+  T &insert_sorted(size_t cam_id) {
+    // Move to the heap if our inline array is full
+    if (_heap.empty() && _size == INLINE_SIZE) {
+      _heap.resize(2 * INLINE_SIZE);
+      for (size_t i = 0; i < _size; i++) {
+        _heap.at(i).first = _inline[i].first;
+        _heap.at(i).second = std::move(_inline[i].second);
+        _inline[i].second = T();
+      }
+    } else if (!_heap.empty() && _size == _heap.size()) {
+      _heap.resize(2 * _heap.size());
+    }
+    // Shift everything after it back one
+    size_t idx = lower_bound(cam_id) - begin();
+    value_type *entries = data();
+    std::move_backward(entries + idx, entries + _size, entries + _size + 1);
+    entries[idx].first = cam_id;
+    entries[idx].second = T();
+    _size++;
+    return entries[idx].second;
+  }
+
+  /// Storage for our first cameras
+  value_type _inline[INLINE_SIZE];
+
+  /// Storage if we have more cameras than fit inline
+  std::vector<value_type> _heap;
+
+  /// Number of cameras we have
+  size_t _size = 0;
+};
+
+} // namespace ov_core
+
+#endif // OV_CORE_CAMERA_MAP_H
@@ -0,0 +1,144 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2021 Patrick Geneva
+ * Copyright (C) 2021 Guoquan Huang
+ * Copyright (C) 2021 OpenVINS Contributors
+ * Copyright (C) 2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OV_CORE_CHI_SQUARED_TABLE_H
+#define OV_CORE_CHI_SQUARED_TABLE_H
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include <boost/math/distributions/chi_squared.hpp>
+
+namespace ov_core {
+
+/**
+ * @brief Lookup table of chi-squared quantiles for a given confidence level.
+ *
+ * Each chi2 test needs the quantile for the size of its residual, which is slow to compute with boost.
+ * The table is split into chunks of degrees of freedom, where each chunk is computed the first time one of its entries is needed.
+ * The first chunk is computed on construction, so the common (small) residual sizes never need to be computed during an update.
+ * Lookups of computed chunks are lock free, so this can be used by the updaters from multiple threads.
+ *
+ * Tables should be gotten through get(), so all updaters with the same confidence level share one table.
+ * Residuals larger then we will store (see MAX_CHUNKS) have their quantile computed each time.
+ *
+ * See the [msckf_vio](https://github.com/KumarRobotics/msckf_vio/blob/050c50defa5a7fd9a04c1eed5687b405f02919b5/src/msckf_vio.cpp#L215-L221)
+ * implementation where this table originally comes from.
+ */
+class ChiSquaredTable {
+
+public:
+  /// Number of degrees of freedom we compute at a time
+  static const int CHUNK_SIZE = 512;
+
+  /// Max number of chunks we will store
+  static const int MAX_CHUNKS = 128;
+
+  /**
+   * @brief Gets the table shared by everyone using this confidence level (created on first use)
+   * @param confidence Confidence level of the quantiles (e.g. 0.95)
+   * @return Shared table for this confidence level
+   */
+  static std::shared_ptr<ChiSquaredTable> get(double confidence = 0.95) {
+    static std::mutex mtx_tables;
+    static std::map<double, std::shared_ptr<ChiSquaredTable>> tables;
+    std::lock_guard<std::mutex> lck(mtx_tables);
+    std::shared_ptr<ChiSquaredTable> &table = tables[confidence];
+    if (table == nullptr)
+      table = std::make_shared<ChiSquaredTable>(confidence);
+    return table;
+  }
+
+  /**
+   * @brief Default constructor, will compute the first chunk of the table
+   * @param confidence Confidence level of the quantiles (e.g. 0.95)
+   */
+  explicit ChiSquaredTable(double confidence = 0.95) : _confidence(confidence) {
+    for (int i = 0; i < MAX_CHUNKS; i++)
+      _chunks[i].store(nullptr);
+    compute_chunk(0);
+  }
+
+  ~ChiSquaredTable() {
+    for (int i = 0; i < MAX_CHUNKS; i++)
+      delete[] _chunks[i].load();
+  }
+
+  ChiSquaredTable(const ChiSquaredTable &) = delete;
+  ChiSquaredTable &operator=(const ChiSquaredTable &) = delete;
+
+  /// Confidence level of our quantiles
+  double confidence() const { return _confidence; }
+
+  /**
+   * @brief Gets the quantile for a residual size
+   * @param dof Degrees of freedom (size of the residual)
+   * @return Chi-squared value which the given confidence of samples are below
+   */
+  double quantile(int dof) {
+    if (dof < 1)
+      return 0.0;
+    int chunk = dof / CHUNK_SIZE;
+    if (chunk >= MAX_CHUNKS)
+      return compute(dof);
+    const double *values = _chunks[chunk].load(std::memory_order_acquire);
+    if (values == nullptr)
+      values = compute_chunk(chunk);
+    return values[dof % CHUNK_SIZE];
+  }
+
+protected:
+  /// Computes the quantile for a residual size with boost
+  double compute(int dof) const {
+    boost::math::chi_squared chi_squared_dist(dof);
+    return boost::math::quantile(chi_squared_dist, _confidence);
+  }
+
+  /// Computes a chunk of the table if no one else has yet
+  const double *compute_chunk(int chunk) {
+    std::lock_guard<std::mutex> lck(mtx);
+    const double *values = _chunks[chunk].load(std::memory_order_acquire);
+    if (values != nullptr)
+      return values;
+    double *computed = new double[CHUNK_SIZE];
+    for (int i = 0; i < CHUNK_SIZE; i++) {
+      int dof = chunk * CHUNK_SIZE + i;
+      computed[i] = (dof < 1) ? 0.0 : compute(dof);
+    }
+    _chunks[chunk].store(computed, std::memory_order_release);
+    return computed;
+  }
+
+  /// Confidence level of our quantiles
+  double _confidence;
+
+  /// Mutex lock for computing chunks
+  std::mutex mtx;
+
+  /// Quantiles of each chunk, null if not computed yet
+  std::atomic<const double *> _chunks[MAX_CHUNKS];
+};
+
+} // namespace ov_core
+
+#endif // OV_CORE_CHI_SQUARED_TABLE_H
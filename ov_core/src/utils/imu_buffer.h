@@ -0,0 +1,207 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2021 Patrick Geneva
+ * Copyright (C) 2021 Guoquan Huang
+ * Copyright (C) 2021 OpenVINS Contributors
+ * Copyright (C) 2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OV_CORE_IMU_BUFFER_H
+#define OV_CORE_IMU_BUFFER_H
+
+#include <algorithm>
+#include <cassert>
+#include <mutex>
+#include <vector>
+
+#include "utils/colors.h"
+#include "utils/sensor_data.h"
+
+namespace ov_core {
+
+/**
+ * @brief Time ordered ring buffer of inertial readings.
+ *
+ * Readings are stored in a circular array, so removing readings older than our max time is just moving the start index.
+ * Since all readings are sorted by time, the readings between two times can be found with a binary search.
+ * The array will only be grown if the IMU rate is too high to hold our max time worth of readings, thus after startup
+ * we do not allocate anything when new readings are added.
+ *
+ * This can be shared between the propagator, initializer and zero velocity updater so we only store each reading once.
+ * All functions lock an internal mutex, so feeding and selecting can happen from different threads.
+ */
+class ImuBuffer {
+
+public:
+  /**
+   * @brief Default constructor
+   * @param max_time Amount of time (seconds) of readings we should keep before the newest
+   * @param capacity Initial number of readings we can store
+   */
+  ImuBuffer(double max_time = 10.0, size_t capacity = 4096) : _max_time(max_time), _data(std::max(capacity, (size_t)2)) {}
+
+  /**
+   * @brief Stores a new inertial reading
+   *
+   * Readings that are not newer than our newest reading are skipped.
+   * Thus feeding the same reading multiple times into a shared buffer is fine.
+   *
+   * @param message Contains our timestamp and inertial information
+   */
+  void feed(const ImuData &message) {
+    std::lock_guard<std::mutex> lck(mtx);
+
+    // Skip if not newer then what we have
+    if (_size > 0 && message.timestamp <= at(_size - 1).timestamp) {
+      if (message.timestamp < at(_size - 1).timestamp) {
+        printf(YELLOW "ImuBuffer::feed(): out of order IMU reading (%.4f before newest %.4f), skipping it!\n" RESET, message.timestamp,
+               at(_size - 1).timestamp);
+      }
+      return;
+    }
+
+    // Remove any readings that are older then our max time
+    while (_size > 0 && message.timestamp - at(0).timestamp > _max_time) {
+      _start = (_start + 1) % _data.size();
+      _size--;
+    }
+
+    // Double our storage if we are full, copy over the readings in order
+    if (_size == _data.size()) {
+      std::vector<ImuData> data_new(2 * _data.size());
+      for (size_t i = 0; i < _size; i++) {
+        data_new.at(i) = at(i);
+      }
+      _data.swap(data_new);
+      _start = 0;
+    }
+
+    // Finally append it
+    _data.at((_start + _size) % _data.size()) = message;
+    _size++;
+  }
+
+  /// Number of readings we have
+  size_t size() const {
+    std::lock_guard<std::mutex> lck(mtx);
+    return _size;
+  }
+
+  /// If we do not have any readings
+  bool empty() const {
+    std::lock_guard<std::mutex> lck(mtx);
+    return _size == 0;
+  }
+
+  /// Our oldest reading (buffer should not be empty)
+  ImuData front() const {
+    std::lock_guard<std::mutex> lck(mtx);
+    assert(_size > 0);
+    return at(0);
+  }
+
+  /// Our newest reading (buffer should not be empty)
+  ImuData back() const {
+    std::lock_guard<std::mutex> lck(mtx);
+    assert(_size > 0);
+    return at(_size - 1);
+  }
+
+  /**
+   * @brief Gets all readings which are needed to integrate between two times.
+   *
+   * This will return all readings inside of the interval along with the readings right before and after it.
+   * These bounding readings are needed to interpolate to the start and end times (see Propagator::select_imu_readings()).
+   *
+   * @param time0 Start time of the integration interval
+   * @param time1 End time of the integration interval
+   * @return Readings covering the interval in time order
+   */
+  std::vector<ImuData> get_bounding(double time0, double time1) const {
+    std::lock_guard<std::mutex> lck(mtx);
+    std::vector<ImuData> readings;
+    if (_size == 0)
+      return readings;
+    size_t i0 = lower_index(time0);
+    i0 = (i0 > 0) ? i0 - 1 : 0;
+    size_t i1 = std::min(upper_index(time1) + 1, _size - 1);
+    for (size_t i = i0; i <= i1; i++) {
+      readings.push_back(at(i));
+    }
+    return readings;
+  }
+
+  /**
+   * @brief Gets all readings with a time greater than the start and less than or equal to the end time.
+   * @param time0 Start time (exclusive)
+   * @param time1 End time (inclusive)
+   * @return Readings in the window in time order
+   */
+  std::vector<ImuData> get_window(double time0, double time1) const {
+    std::lock_guard<std::mutex> lck(mtx);
+    std::vector<ImuData> readings;
+    size_t i1 = upper_index(time1);
+    for (size_t i = upper_index(time0); i < i1; i++) {
+      readings.push_back(at(i));
+    }
+    return readings;
+  }
+
+protected:
+  /// Reading at the given index, where 0 is the oldest reading
+  const ImuData &at(size_t i) const { return _data[(_start + i) % _data.size()]; }
+
+  /// Index of the first reading with a time greater or equal to the given
+  size_t lower_index(double timestamp) const {
+    size_t lo = 0, hi = _size;
+    while (lo < hi) {
+      size_t mid = lo + (hi - lo) / 2;
+      if (at(mid).timestamp < timestamp)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+    return lo;
+  }
+
+  /// Index of the first reading with a time greater than the given
+  size_t upper_index(double timestamp) const {
+    size_t lo = 0, hi = _size;
+    while (lo < hi) {
+      size_t mid = lo + (hi - lo) / 2;
+      if (at(mid).timestamp <= timestamp)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+    return lo;
+  }
+
+  /// Mutex lock for our readings
+  mutable std::mutex mtx;
+
+  /// Amount of time (seconds) of readings we keep
+  double _max_time;
+
+  /// Circular storage of our readings, and where the oldest is and how many we have
+  std::vector<ImuData> _data;
+  size_t _start = 0;
+  size_t _size = 0;
+};
+
+} // namespace ov_core
+
+#endif // OV_CORE_IMU_BUFFER_H
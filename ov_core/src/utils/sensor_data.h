@@ -66,6 +66,9 @@ struct CameraData {
   /// Tracking masks for each camera we have
   std::vector<cv::Mat> masks;
 
+  /// Rotation of each camera from its last image to this one (e.g. from the gyroscope), empty if we do not know it
+  std::vector<Eigen::Matrix3d> R_lasttocurr;
+
   /// Sort function to allow for using of STL containers
   bool operator<(const CameraData &other) const {
     if (timestamp == other.timestamp) {
@@ -88,6 +91,9 @@ struct GpsData {
   // cov
   Eigen::Matrix3d cov;
 
+  // If the receiver reported the covariance of this fix (otherwise cov is not used)
+  bool has_cov = true;
+
   bool operator<(const GpsData &other) const {
     return timestamp < other.timestamp;
   }
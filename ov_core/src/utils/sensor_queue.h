@@ -0,0 +1,162 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2021 Patrick Geneva
+ * Copyright (C) 2021 Guoquan Huang
+ * Copyright (C) 2021 OpenVINS Contributors
+ * Copyright (C) 2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OV_CORE_SENSOR_QUEUE_H
+#define OV_CORE_SENSOR_QUEUE_H
+
+#include <algorithm>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace ov_core {
+
+/**
+ * @brief Thread safe, time ordered ring queue of sensor messages.
+ *
+ * Messages are stored in a circular array sorted by time (using the operator< of the message).
+ * New messages are inserted by searching back from the newest message, thus in-order messages are appended
+ * in constant time and an out of order message only shifts the few messages that are newer than it.
+ * The array is only grown if the queue is full, so after startup pushing and popping does not allocate anything.
+ *
+ * Any number of threads can push (e.g. the callbacks of a multi-threaded ROS spinner) while a single thread pops.
+ * The lock is only held while moving a message in or out, so the producers never wait on the processing of a message.
+ *
+ * @tparam T Message type, needs a timestamp member and to be sorted by operator<
+ */
+template <typename T> class SensorQueue {
+
+public:
+  /**
+   * @brief Default constructor
+   * @param capacity Initial number of messages we can store
+   */
+  explicit SensorQueue(size_t capacity = 64) : _data(std::max(capacity, (size_t)2)) {}
+
+  /**
+   * @brief Inserts a new message at its place in time
+   * @param message Message to insert
+   */
+  void push(const T &message) {
+    std::lock_guard<std::mutex> lck(mtx);
+
+    // Grow our array if we are full (unwrapping it so the oldest is first)
+    if (_size == _data.size()) {
+      std::vector<T> data(2 * _data.size());
+      for (size_t i = 0; i < _size; i++)
+        data.at(i) = std::move(at(i));
+      _data.swap(data);
+      _start = 0;
+    }
+
+    // Shift any messages newer than this one back, and put it in the hole
+    size_t idx = _size;
+    while (idx > 0 && message < at(idx - 1)) {
+      at(idx) = std::move(at(idx - 1));
+      idx--;
+    }
+    at(idx) = message;
+    _size++;
+  }
+
+  /**
+   * @brief Removes the oldest message
+   * @param message Oldest message if we have one
+   * @return False if the queue was empty
+   */
+  bool pop(T &message) {
+    std::lock_guard<std::mutex> lck(mtx);
+    if (_size == 0)
+      return false;
+    pop_front(message);
+    return true;
+  }
+
+  /**
+   * @brief Removes the oldest message if it happened before a given time
+   * @param timestamp Time the message needs to be older than
+   * @param message Oldest message if it was older than the time
+   * @return False if there is no message older than the time
+   */
+  bool pop_before(double timestamp, T &message) {
+    std::lock_guard<std::mutex> lck(mtx);
+    if (_size == 0 || !(at(0).timestamp < timestamp))
+      return false;
+    pop_front(message);
+    return true;
+  }
+
+  /**
+   * @brief Calls a function on each message from oldest to newest (the queue is locked while doing so)
+   * @param func Function taking a const reference to a message
+   */
+  template <typename Func> void for_each(Func func) {
+    std::lock_guard<std::mutex> lck(mtx);
+    for (size_t i = 0; i < _size; i++)
+      func(at(i));
+  }
+
+  /// Number of messages we have
+  size_t size() {
+    std::lock_guard<std::mutex> lck(mtx);
+    return _size;
+  }
+
+  /// If we do not have any messages
+  bool empty() { return size() == 0; }
+
+  /// Removes all messages
+  void clear() {
+    std::lock_guard<std::mutex> lck(mtx);
+    for (size_t i = 0; i < _size; i++)
+      at(i) = T();
+    _start = 0;
+    _size = 0;
+  }
+
+protected:
+  /// Message at an index from our oldest (mutex should be locked)
+  T &at(size_t i) { return _data[(_start + i) % _data.size()]; }
+
+  /// Moves out our oldest message (mutex should be locked, and we should not be empty)
+  void pop_front(T &message) {
+    message = std::move(at(0));
+    at(0) = T();
+    _start = (_start + 1) % _data.size();
+    _size--;
+  }
+
+  /// Mutex lock for our messages
+  std::mutex mtx;
+
+  /// Circular array of our messages
+  std::vector<T> _data;
+
+  /// Index of our oldest message in the array
+  size_t _start = 0;
+
+  /// Number of messages we have
+  size_t _size = 0;
+};
+
+} // namespace ov_core
+
+#endif // OV_CORE_SENSOR_QUEUE_H
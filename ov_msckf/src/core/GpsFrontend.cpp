@@ -0,0 +1,70 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2021 Patrick Geneva
+ * Copyright (C) 2021 Guoquan Huang
+ * Copyright (C) 2021 OpenVINS Contributors
+ * Copyright (C) 2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "GpsFrontend.h"
+
+#include <LocalCartesian.hpp>
+
+using namespace ov_msckf;
+
+void GpsFrontend::set_origin(const Eigen::Vector3d &lla) {
+  auto projection_new = std::make_shared<const GeographicLib::LocalCartesian>(lla(1), lla(0), lla(2));
+  std::lock_guard<std::mutex> lck(mtx);
+  projection = projection_new;
+  origin_lla = lla;
+}
+
+void GpsFrontend::reset_origin() {
+  std::lock_guard<std::mutex> lck(mtx);
+  projection = nullptr;
+  origin_lla.setZero();
+}
+
+bool GpsFrontend::has_origin() { return get_projection() != nullptr; }
+
+Eigen::Vector3d GpsFrontend::get_origin() {
+  std::lock_guard<std::mutex> lck(mtx);
+  return origin_lla;
+}
+
+bool GpsFrontend::to_enu(const Eigen::Vector3d &lla, Eigen::Vector3d &p_enu) {
+  std::shared_ptr<const GeographicLib::LocalCartesian> proj = get_projection();
+  if (proj == nullptr)
+    return false;
+  proj->Forward(lla(1), lla(0), lla(2), p_enu(0), p_enu(1), p_enu(2));
+  return true;
+}
+
+bool GpsFrontend::to_enu(const std::vector<ov_core::GpsData> &fixes, std::vector<Eigen::Vector3d> &p_enu) {
+  std::shared_ptr<const GeographicLib::LocalCartesian> proj = get_projection();
+  if (proj == nullptr)
+    return false;
+  p_enu.resize(fixes.size());
+  for (size_t i = 0; i < fixes.size(); i++) {
+    proj->Forward(fixes.at(i).lla(1), fixes.at(i).lla(0), fixes.at(i).lla(2), p_enu.at(i)(0), p_enu.at(i)(1), p_enu.at(i)(2));
+  }
+  return true;
+}
+
+std::shared_ptr<const GeographicLib::LocalCartesian> GpsFrontend::get_projection() {
+  std::lock_guard<std::mutex> lck(mtx);
+  return projection;
+}
@@ -0,0 +1,98 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2021 Patrick Geneva
+ * Copyright (C) 2021 Guoquan Huang
+ * Copyright (C) 2021 OpenVINS Contributors
+ * Copyright (C) 2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OV_MSCKF_GPS_FRONTEND_H
+#define OV_MSCKF_GPS_FRONTEND_H
+
+#include <Eigen/Eigen>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "utils/sensor_data.h"
+
+namespace GeographicLib {
+class LocalCartesian;
+}
+
+namespace ov_msckf {
+
+/**
+ * @brief Converts GPS fixes into our local east-north-up (ENU) frame.
+ *
+ * The ENU origin is fixed once (e.g. at the last fix before we initialize), after which the local cartesian
+ * projection (and its ECEF to ENU rotation) is computed once and reused for every fix.
+ * The projection is never changed after being created, and a new origin creates a new one, so conversions only hold the lock
+ * long enough to get the current projection and can happen from multiple threads.
+ *
+ * Fixes are stored as in ov_core::GpsData, that is longitude, latitude and height.
+ */
+class GpsFrontend {
+
+public:
+  /**
+   * @brief Sets the origin of our ENU frame
+   * @param lla Longitude, latitude and height of the origin
+   */
+  void set_origin(const Eigen::Vector3d &lla);
+
+  /// Removes our origin, so it can be set again (e.g. after a reset of the estimator)
+  void reset_origin();
+
+  /// If we have an origin, and can convert fixes
+  bool has_origin();
+
+  /// Longitude, latitude and height of our origin (zero if we do not have one)
+  Eigen::Vector3d get_origin();
+
+  /**
+   * @brief Converts a single fix into our ENU frame
+   * @param lla Longitude, latitude and height of the fix
+   * @param p_enu Position in our ENU frame
+   * @return False if we do not have an origin yet
+   */
+  bool to_enu(const Eigen::Vector3d &lla, Eigen::Vector3d &p_enu);
+
+  /**
+   * @brief Converts a set of buffered fixes into our ENU frame (all with the same origin)
+   * @param fixes GPS fixes we want to convert
+   * @param p_enu Position of each fix in our ENU frame
+   * @return False if we do not have an origin yet
+   */
+  bool to_enu(const std::vector<ov_core::GpsData> &fixes, std::vector<Eigen::Vector3d> &p_enu);
+
+protected:
+  /// Gets our current projection (null if we do not have an origin)
+  std::shared_ptr<const GeographicLib::LocalCartesian> get_projection();
+
+  /// Mutex for our projection
+  std::mutex mtx;
+
+  /// Local cartesian projection at our origin, never changed after being created
+  std::shared_ptr<const GeographicLib::LocalCartesian> projection;
+
+  /// Longitude, latitude and height of our origin
+  Eigen::Vector3d origin_lla = Eigen::Vector3d::Zero();
+};
+
+} // namespace ov_msckf
+
+#endif // OV_MSCKF_GPS_FRONTEND_H
@@ -0,0 +1,123 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2021 Patrick Geneva
+ * Copyright (C) 2021 Guoquan Huang
+ * Copyright (C) 2021 OpenVINS Contributors
+ * Copyright (C) 2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OV_MSCKF_PATH_PUBLISHER_H
+#define OV_MSCKF_PATH_PUBLISHER_H
+
+#include <geometry_msgs/PoseStamped.h>
+#include <nav_msgs/Path.h>
+#include <ros/ros.h>
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+namespace ov_msckf {
+
+/**
+ * @brief Publishes a trajectory as a bounded nav_msgs::Path along with an append only pose topic.
+ *
+ * Republishing the whole trajectory each time grows the message (and the time to serialize it) for the whole run.
+ * Thus we only keep poses that are far enough in distance and time from the last one we kept,
+ * and once we have more than our max length we drop every other pose, so the path still covers the whole trajectory.
+ * Each pose we keep is also published by itself on the "<topic>_incremental" topic, so a subscriber can build the full path.
+ */
+class PathPublisher {
+
+public:
+  /**
+   * @brief Default constructor, will advertise our topics
+   * @param nh ROS node handle to advertise with
+   * @param topic Topic of the path (the incremental poses will be on "<topic>_incremental")
+   * @param frame_id Frame the poses are in
+   * @param max_length Max number of poses in the published path
+   * @param min_distance Min distance (meters) from the last kept pose for a new pose to be kept
+   * @param min_dt Min time (seconds) since the last kept pose for a new pose to be kept
+   */
+  PathPublisher(ros::NodeHandle &nh, const std::string &topic, const std::string &frame_id, int max_length = 16384,
+                double min_distance = 0.0, double min_dt = 0.0)
+      : _max_length((size_t)std::max(max_length, 2)), _min_distance(min_distance), _min_dt(min_dt) {
+    pub_path = nh.advertise<nav_msgs::Path>(topic, 2);
+    pub_incremental = nh.advertise<geometry_msgs::PoseStamped>(topic + "_incremental", 100);
+    path.header.frame_id = frame_id;
+  }
+
+  /**
+   * @brief Appends a pose and publishes the path if we kept it
+   * @param pose New pose (its frame_id will be set to ours)
+   * @return False if the pose was too close to the last one and was not kept
+   */
+  bool append(const geometry_msgs::PoseStamped &pose) {
+
+    // Skip if we have not moved far enough since the last pose
+    if (!path.poses.empty()) {
+      const geometry_msgs::PoseStamped &last = path.poses.back();
+      double dx = pose.pose.position.x - last.pose.position.x;
+      double dy = pose.pose.position.y - last.pose.position.y;
+      double dz = pose.pose.position.z - last.pose.position.z;
+      double dt = (pose.header.stamp - last.header.stamp).toSec();
+      if (std::sqrt(dx * dx + dy * dy + dz * dz) < _min_distance || std::abs(dt) < _min_dt)
+        return false;
+    }
+
+    // Append it, and publish it by itself
+    path.poses.push_back(pose);
+    path.poses.back().header.frame_id = path.header.frame_id;
+    pub_incremental.publish(path.poses.back());
+
+    // If we are too long, then drop every other pose (always keeping the newest)
+    if (path.poses.size() > _max_length) {
+      size_t num_kept = 0;
+      for (size_t i = (path.poses.size() - 1) % 2; i < path.poses.size(); i += 2)
+        path.poses.at(num_kept++) = path.poses.at(i);
+      path.poses.resize(num_kept);
+    }
+
+    // Publish the path
+    path.header.stamp = ros::Time::now();
+    path.header.seq++;
+    pub_path.publish(path);
+    return true;
+  }
+
+  /// Number of poses in our path
+  size_t size() const { return path.poses.size(); }
+
+protected:
+  /// Max number of poses in our path
+  size_t _max_length;
+
+  /// Min distance (meters) between poses we keep
+  double _min_distance;
+
+  /// Min time (seconds) between poses we keep
+  double _min_dt;
+
+  /// Our current path
+  nav_msgs::Path path;
+
+  /// Publishers of the path and each new pose
+  ros::Publisher pub_path, pub_incremental;
+};
+
+} // namespace ov_msckf
+
+#endif // OV_MSCKF_PATH_PUBLISHER_H
@@ -33,8 +33,10 @@ RosVisualizer::RosVisualizer(ros::NodeHandle &nh, std::shared_ptr<VioManager> ap
   ROS_INFO("Publishing: %s", pub_poseimu.getTopic().c_str());
   pub_odomimu = nh.advertise<nav_msgs::Odometry>("/ov_msckf/odomimu", 2);
   ROS_INFO("Publishing: %s", pub_odomimu.getTopic().c_str());
-  pub_pathimu = nh.advertise<nav_msgs::Path>("/ov_msckf/pathimu", 2);
-  ROS_INFO("Publishing: %s", pub_pathimu.getTopic().c_str());
+  const VioManagerOptions &params = _app->get_params();
+  path_imu = std::make_shared<PathPublisher>(nh, "/ov_msckf/pathimu", "global", params.path_max_length, params.path_min_distance,
+                                             params.path_min_dt);
+  ROS_INFO("Publishing: /ov_msckf/pathimu");
 
   // 3D points publishing
   pub_points_msckf = nh.advertise<sensor_msgs::PointCloud2>("/ov_msckf/points_msckf", 2);
@@ -53,8 +55,9 @@ RosVisualizer::RosVisualizer(ros::NodeHandle &nh, std::shared_ptr<VioManager> ap
   // Groundtruth publishers
   pub_posegt = nh.advertise<geometry_msgs::PoseStamped>("/ov_msckf/posegt", 2);
   ROS_INFO("Publishing: %s", pub_posegt.getTopic().c_str());
-  pub_pathgt = nh.advertise<nav_msgs::Path>("/ov_msckf/pathgt", 2);
-  ROS_INFO("Publishing: %s", pub_pathgt.getTopic().c_str());
+  path_gt = std::make_shared<PathPublisher>(nh, "/ov_msckf/pathgt", "global", params.path_max_length, params.path_min_distance,
+                                            params.path_min_dt);
+  ROS_INFO("Publishing: /ov_msckf/pathgt");
 
   // Loop closure publishers
   pub_loop_pose = nh.advertise<nav_msgs::Odometry>("/ov_msckf/loop_pose", 2);
@@ -90,25 +93,8 @@ RosVisualizer::RosVisualizer(ros::NodeHandle &nh, std::shared_ptr<VioManager> ap
     nh.param<std::string>("filepath_std", filepath_std, "state_deviation.txt");
     nh.param<std::string>("filepath_gt", filepath_gt, "state_groundtruth.txt");
 
-    // If it exists, then delete it
-    if (boost::filesystem::exists(filepath_est))
-      boost::filesystem::remove(filepath_est);
-    if (boost::filesystem::exists(filepath_std))
-      boost::filesystem::remove(filepath_std);
-
-    // Open the files
-    of_state_est.open(filepath_est.c_str());
-    of_state_std.open(filepath_std.c_str());
-    of_state_est << "# timestamp(s) q p v bg ba cam_imu_dt num_cam cam0_k cam0_d cam0_rot cam0_trans .... etc" << std::endl;
-    of_state_std << "# timestamp(s) q p v bg ba cam_imu_dt num_cam cam0_k cam0_d cam0_rot cam0_trans .... etc" << std::endl;
-
-    // Groundtruth if we are simulating
-    if (_sim != nullptr) {
-      if (boost::filesystem::exists(filepath_gt))
-        boost::filesystem::remove(filepath_gt);
-      of_state_gt.open(filepath_gt.c_str());
-      of_state_gt << "# timestamp(s) q p v bg ba cam_imu_dt num_cam cam0_k cam0_d cam0_rot cam0_trans .... etc" << std::endl;
-    }
+    // Open the files (groundtruth only if we are simulating)
+    state_recorder = std::make_shared<StateRecorder>(filepath_est, filepath_std, filepath_gt, _sim);
   }
 }
 
@@ -316,23 +302,12 @@ void RosVisualizer::publish_state() {
   //=========================================================
   //=========================================================
 
-  // Append to our pose vector
+  // Append to our path (imu)
+  // NOTE: The path is bounded so we do not crash rviz (https://github.com/ros-visualization/rviz/issues/1107)
   geometry_msgs::PoseStamped posetemp;
   posetemp.header = poseIinM.header;
   posetemp.pose = poseIinM.pose.pose;
-  poses_imu.push_back(posetemp);
-
-  // Create our path (imu)
-  // NOTE: We downsample the number of poses as needed to prevent rviz crashes
-  // NOTE: https://github.com/ros-visualization/rviz/issues/1107
-  nav_msgs::Path arrIMU;
-  arrIMU.header.stamp = ros::Time::now();
-  arrIMU.header.seq = poses_seq_imu;
-  arrIMU.header.frame_id = "global";
-  for (size_t i = 0; i < poses_imu.size(); i += std::floor(poses_imu.size() / 16384.0) + 1) {
-    arrIMU.poses.push_back(poses_imu.at(i));
-  }
-  pub_pathimu.publish(arrIMU);
+  path_imu->append(posetemp);
 
   // Move them forward in time
   poses_seq_imu++;
@@ -593,20 +568,9 @@ void RosVisualizer::publish_groundtruth() {
   poseIinM.pose.position.z = state_gt(7, 0);
   pub_posegt.publish(poseIinM);
 
-  // Append to our pose vector
-  poses_gt.push_back(poseIinM);
-
-  // Create our path (imu)
-  // NOTE: We downsample the number of poses as needed to prevent rviz crashes
-  // NOTE: https://github.com/ros-visualization/rviz/issues/1107
-  nav_msgs::Path arrIMU;
-  arrIMU.header.stamp = ros::Time::now();
-  arrIMU.header.seq = poses_seq_gt;
-  arrIMU.header.frame_id = "global";
-  for (size_t i = 0; i < poses_gt.size(); i += std::floor(poses_gt.size() / 16384.0) + 1) {
-    arrIMU.poses.push_back(poses_gt.at(i));
-  }
-  pub_pathgt.publish(arrIMU);
+  // Append to our path (groundtruth)
+  // NOTE: The path is bounded so we do not crash rviz (https://github.com/ros-visualization/rviz/issues/1107)
+  path_gt->append(poseIinM);
 
   // Move them forward in time
   poses_seq_gt++;
@@ -844,153 +808,4 @@ void RosVisualizer::publish_loopclosure_information() {
   }
 }
 
-void RosVisualizer::sim_save_total_state_to_file() {
-
-  // Get current state
-  std::shared_ptr<State> state = _app->get_state();
-
-  // We want to publish in the IMU clock frame
-  // The timestamp in the state will be the last camera time
-  double t_ItoC = state->_calib_dt_CAMtoIMU->value()(0);
-  double timestamp_inI = state->_timestamp + t_ItoC;
-
-  // If we have our simulator, then save it to our groundtruth file
-  if (_sim != nullptr) {
-
-    // Note that we get the true time in the IMU clock frame
-    // NOTE: we record both the estimate and groundtruth with the same "true" timestamp if we are doing simulation
-    Eigen::Matrix<double, 17, 1> state_gt;
-    timestamp_inI = state->_timestamp + _sim->get_true_paramters().calib_camimu_dt;
-    if (_sim->get_state(timestamp_inI, state_gt)) {
-      // STATE: write current true state
-      of_state_gt.precision(5);
-      of_state_gt.setf(std::ios::fixed, std::ios::floatfield);
-      of_state_gt << state_gt(0) << " ";
-      of_state_gt.precision(6);
-      of_state_gt << state_gt(1) << " " << state_gt(2) << " " << state_gt(3) << " " << state_gt(4) << " ";
-      of_state_gt << state_gt(5) << " " << state_gt(6) << " " << state_gt(7) << " ";
-      of_state_gt << state_gt(8) << " " << state_gt(9) << " " << state_gt(10) << " ";
-      of_state_gt << state_gt(11) << " " << state_gt(12) << " " << state_gt(13) << " ";
-      of_state_gt << state_gt(14) << " " << state_gt(15) << " " << state_gt(16) << " ";
-
-      // TIMEOFF: Get the current true time offset
-      of_state_gt.precision(7);
-      of_state_gt << _sim->get_true_paramters().calib_camimu_dt << " ";
-      of_state_gt.precision(0);
-      of_state_gt << state->_options.num_cameras << " ";
-      of_state_gt.precision(6);
-
-      // CALIBRATION: Write the camera values to file
-      assert(state->_options.num_cameras == _sim->get_true_paramters().state_options.num_cameras);
-      for (int i = 0; i < state->_options.num_cameras; i++) {
-        // Intrinsics values
-        of_state_gt << _sim->get_true_paramters().camera_intrinsics.at(i)(0) << " " << _sim->get_true_paramters().camera_intrinsics.at(i)(1)
-                    << " " << _sim->get_true_paramters().camera_intrinsics.at(i)(2) << " "
-                    << _sim->get_true_paramters().camera_intrinsics.at(i)(3) << " ";
-        of_state_gt << _sim->get_true_paramters().camera_intrinsics.at(i)(4) << " " << _sim->get_true_paramters().camera_intrinsics.at(i)(5)
-                    << " " << _sim->get_true_paramters().camera_intrinsics.at(i)(6) << " "
-                    << _sim->get_true_paramters().camera_intrinsics.at(i)(7) << " ";
-        // Rotation and position
-        of_state_gt << _sim->get_true_paramters().camera_extrinsics.at(i)(0) << " " << _sim->get_true_paramters().camera_extrinsics.at(i)(1)
-                    << " " << _sim->get_true_paramters().camera_extrinsics.at(i)(2) << " "
-                    << _sim->get_true_paramters().camera_extrinsics.at(i)(3) << " ";
-        of_state_gt << _sim->get_true_paramters().camera_extrinsics.at(i)(4) << " " << _sim->get_true_paramters().camera_extrinsics.at(i)(5)
-                    << " " << _sim->get_true_paramters().camera_extrinsics.at(i)(6) << " ";
-      }
-
-      // New line
-      of_state_gt << endl;
-    }
-  }
-
-  //==========================================================================
-  //==========================================================================
-  //==========================================================================
-
-  // Get the covariance of the whole system
-  Eigen::MatrixXd cov = StateHelper::get_full_covariance(state);
-
-  // STATE: Write the current state to file
-  of_state_est.precision(5);
-  of_state_est.setf(std::ios::fixed, std::ios::floatfield);
-  of_state_est << timestamp_inI << " ";
-  of_state_est.precision(6);
-  of_state_est << state->_imu->quat()(0) << " " << state->_imu->quat()(1) << " " << state->_imu->quat()(2) << " " << state->_imu->quat()(3)
-               << " ";
-  of_state_est << state->_imu->pos()(0) << " " << state->_imu->pos()(1) << " " << state->_imu->pos()(2) << " ";
-  of_state_est << state->_imu->vel()(0) << " " << state->_imu->vel()(1) << " " << state->_imu->vel()(2) << " ";
-  of_state_est << state->_imu->bias_g()(0) << " " << state->_imu->bias_g()(1) << " " << state->_imu->bias_g()(2) << " ";
-  of_state_est << state->_imu->bias_a()(0) << " " << state->_imu->bias_a()(1) << " " << state->_imu->bias_a()(2) << " ";
-
-  // STATE: Write current uncertainty to file
-  of_state_std.precision(5);
-  of_state_std.setf(std::ios::fixed, std::ios::floatfield);
-  of_state_std << timestamp_inI << " ";
-  of_state_std.precision(6);
-  int id = state->_imu->q()->id();
-  of_state_std << std::sqrt(cov(id + 0, id + 0)) << " " << std::sqrt(cov(id + 1, id + 1)) << " " << std::sqrt(cov(id + 2, id + 2)) << " ";
-  id = state->_imu->p()->id();
-  of_state_std << std::sqrt(cov(id + 0, id + 0)) << " " << std::sqrt(cov(id + 1, id + 1)) << " " << std::sqrt(cov(id + 2, id + 2)) << " ";
-  id = state->_imu->v()->id();
-  of_state_std << std::sqrt(cov(id + 0, id + 0)) << " " << std::sqrt(cov(id + 1, id + 1)) << " " << std::sqrt(cov(id + 2, id + 2)) << " ";
-  id = state->_imu->bg()->id();
-  of_state_std << std::sqrt(cov(id + 0, id + 0)) << " " << std::sqrt(cov(id + 1, id + 1)) << " " << std::sqrt(cov(id + 2, id + 2)) << " ";
-  id = state->_imu->ba()->id();
-  of_state_std << std::sqrt(cov(id + 0, id + 0)) << " " << std::sqrt(cov(id + 1, id + 1)) << " " << std::sqrt(cov(id + 2, id + 2)) << " ";
-
-  // TIMEOFF: Get the current estimate time offset
-  of_state_est.precision(7);
-  of_state_est << state->_calib_dt_CAMtoIMU->value()(0) << " ";
-  of_state_est.precision(0);
-  of_state_est << state->_options.num_cameras << " ";
-  of_state_est.precision(6);
-
-  // TIMEOFF: Get the current std values
-  if (state->_options.do_calib_camera_timeoffset) {
-    of_state_std << std::sqrt(cov(state->_calib_dt_CAMtoIMU->id(), state->_calib_dt_CAMtoIMU->id())) << " ";
-  } else {
-    of_state_std << 0.0 << " ";
-  }
-  of_state_std.precision(0);
-  of_state_std << state->_options.num_cameras << " ";
-  of_state_std.precision(6);
-
-  // CALIBRATION: Write the camera values to file
-  for (int i = 0; i < state->_options.num_cameras; i++) {
-    // Intrinsics values
-    of_state_est << state->_cam_intrinsics.at(i)->value()(0) << " " << state->_cam_intrinsics.at(i)->value()(1) << " "
-                 << state->_cam_intrinsics.at(i)->value()(2) << " " << state->_cam_intrinsics.at(i)->value()(3) << " ";
-    of_state_est << state->_cam_intrinsics.at(i)->value()(4) << " " << state->_cam_intrinsics.at(i)->value()(5) << " "
-                 << state->_cam_intrinsics.at(i)->value()(6) << " " << state->_cam_intrinsics.at(i)->value()(7) << " ";
-    // Rotation and position
-    of_state_est << state->_calib_IMUtoCAM.at(i)->value()(0) << " " << state->_calib_IMUtoCAM.at(i)->value()(1) << " "
-                 << state->_calib_IMUtoCAM.at(i)->value()(2) << " " << state->_calib_IMUtoCAM.at(i)->value()(3) << " ";
-    of_state_est << state->_calib_IMUtoCAM.at(i)->value()(4) << " " << state->_calib_IMUtoCAM.at(i)->value()(5) << " "
-                 << state->_calib_IMUtoCAM.at(i)->value()(6) << " ";
-    // Covariance
-    if (state->_options.do_calib_camera_intrinsics) {
-      int index_in = state->_cam_intrinsics.at(i)->id();
-      of_state_std << std::sqrt(cov(index_in + 0, index_in + 0)) << " " << std::sqrt(cov(index_in + 1, index_in + 1)) << " "
-                   << std::sqrt(cov(index_in + 2, index_in + 2)) << " " << std::sqrt(cov(index_in + 3, index_in + 3)) << " ";
-      of_state_std << std::sqrt(cov(index_in + 4, index_in + 4)) << " " << std::sqrt(cov(index_in + 5, index_in + 5)) << " "
-                   << std::sqrt(cov(index_in + 6, index_in + 6)) << " " << std::sqrt(cov(index_in + 7, index_in + 7)) << " ";
-    } else {
-      of_state_std << 0.0 << " " << 0.0 << " " << 0.0 << " " << 0.0 << " ";
-      of_state_std << 0.0 << " " << 0.0 << " " << 0.0 << " " << 0.0 << " ";
-    }
-    if (state->_options.do_calib_camera_pose) {
-      int index_ex = state->_calib_IMUtoCAM.at(i)->id();
-      of_state_std << std::sqrt(cov(index_ex + 0, index_ex + 0)) << " " << std::sqrt(cov(index_ex + 1, index_ex + 1)) << " "
-                   << std::sqrt(cov(index_ex + 2, index_ex + 2)) << " ";
-      of_state_std << std::sqrt(cov(index_ex + 3, index_ex + 3)) << " " << std::sqrt(cov(index_ex + 4, index_ex + 4)) << " "
-                   << std::sqrt(cov(index_ex + 5, index_ex + 5)) << " ";
-    } else {
-      of_state_std << 0.0 << " " << 0.0 << " " << 0.0 << " ";
-      of_state_std << 0.0 << " " << 0.0 << " " << 0.0 << " ";
-    }
-  }
-
-  // Done with the estimates!
-  of_state_est << endl;
-  of_state_std << endl;
-}
+void RosVisualizer::sim_save_total_state_to_file() { state_recorder->save(_app->get_state()); }
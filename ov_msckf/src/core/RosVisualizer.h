@@ -40,6 +40,8 @@
 #include <boost/filesystem.hpp>
 #include <cv_bridge/cv_bridge.h>
 
+#include "PathPublisher.h"
+#include "StateRecorder.h"
 #include "VioManager.h"
 #include "sim/Simulator.h"
 #include "utils/dataset_reader.h"
@@ -110,7 +112,7 @@ protected:
   std::shared_ptr<Simulator> _sim;
 
   // Our publishers
-  ros::Publisher pub_poseimu, pub_odomimu, pub_pathimu, pub_pathgps;
+  ros::Publisher pub_poseimu, pub_odomimu;
   ros::Publisher pub_points_msckf, pub_points_slam, pub_points_aruco, pub_points_sim;
   ros::Publisher pub_tracks;
   ros::Publisher pub_loop_pose, pub_loop_point, pub_loop_extrinsic, pub_loop_intrinsics;
@@ -119,11 +121,10 @@ protected:
 
   // For path viz
   unsigned int poses_seq_imu = 0;
-  vector<geometry_msgs::PoseStamped> poses_imu;
-  nav_msgs::Path gps_path;
+  std::shared_ptr<PathPublisher> path_imu;
 
   // Groundtruth infomation
-  ros::Publisher pub_pathgt, pub_posegt;
+  ros::Publisher pub_posegt;
   double summed_rmse_ori = 0.0;
   double summed_rmse_pos = 0.0;
   double summed_nees_ori = 0.0;
@@ -142,13 +143,13 @@ protected:
 
   // For path viz
   unsigned int poses_seq_gt = 0;
-  vector<geometry_msgs::PoseStamped> poses_gt;
+  std::shared_ptr<PathPublisher> path_gt;
   bool publish_global2imu_tf = true;
   bool publish_calibration_tf = true;
 
   // Files and if we should save total state
   bool save_total_state;
-  std::ofstream of_state_est, of_state_std, of_state_gt;
+  std::shared_ptr<StateRecorder> state_recorder;
 };
 
 } // namespace ov_msckf
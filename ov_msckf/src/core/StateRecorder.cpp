@@ -0,0 +1,204 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2021 Patrick Geneva
+ * Copyright (C) 2021 Guoquan Huang
+ * Copyright (C) 2021 OpenVINS Contributors
+ * Copyright (C) 2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "StateRecorder.h"
+
+#include <boost/filesystem.hpp>
+
+#include "state/StateHelper.h"
+
+using namespace ov_msckf;
+
+StateRecorder::StateRecorder(const std::string &filepath_est, const std::string &filepath_std, const std::string &filepath_gt,
+                             std::shared_ptr<Simulator> sim)
+    : _sim(sim) {
+
+  // Open the files
+  open_file(of_state_est, filepath_est);
+  open_file(of_state_std, filepath_std);
+  of_state_est << "# timestamp(s) q p v bg ba cam_imu_dt num_cam cam0_k cam0_d cam0_rot cam0_trans .... etc" << std::endl;
+  of_state_std << "# timestamp(s) q p v bg ba cam_imu_dt num_cam cam0_k cam0_d cam0_rot cam0_trans .... etc" << std::endl;
+
+  // Groundtruth if we are simulating
+  if (_sim != nullptr) {
+    open_file(of_state_gt, filepath_gt);
+    of_state_gt << "# timestamp(s) q p v bg ba cam_imu_dt num_cam cam0_k cam0_d cam0_rot cam0_trans .... etc" << std::endl;
+  }
+}
+
+void StateRecorder::open_file(std::ofstream &of, const std::string &filepath) {
+  // If it exists, then delete it
+  if (boost::filesystem::exists(filepath))
+    boost::filesystem::remove(filepath);
+  // Create the directory it is in
+  boost::filesystem::path p(filepath);
+  if (p.has_parent_path())
+    boost::filesystem::create_directories(p.parent_path());
+  of.open(filepath.c_str());
+}
+
+void StateRecorder::save(std::shared_ptr<State> state) {
+
+  // We want to publish in the IMU clock frame
+  // The timestamp in the state will be the last camera time
+  double t_ItoC = state->_calib_dt_CAMtoIMU->value()(0);
+  double timestamp_inI = state->_timestamp + t_ItoC;
+
+  // If we have our simulator, then save it to our groundtruth file
+  if (_sim != nullptr) {
+
+    // Note that we get the true time in the IMU clock frame
+    // NOTE: we record both the estimate and groundtruth with the same "true" timestamp if we are doing simulation
+    Eigen::Matrix<double, 17, 1> state_gt;
+    timestamp_inI = state->_timestamp + _sim->get_true_paramters().calib_camimu_dt;
+    if (_sim->get_state(timestamp_inI, state_gt)) {
+      // STATE: write current true state
+      of_state_gt.precision(5);
+      of_state_gt.setf(std::ios::fixed, std::ios::floatfield);
+      of_state_gt << state_gt(0) << " ";
+      of_state_gt.precision(6);
+      of_state_gt << state_gt(1) << " " << state_gt(2) << " " << state_gt(3) << " " << state_gt(4) << " ";
+      of_state_gt << state_gt(5) << " " << state_gt(6) << " " << state_gt(7) << " ";
+      of_state_gt << state_gt(8) << " " << state_gt(9) << " " << state_gt(10) << " ";
+      of_state_gt << state_gt(11) << " " << state_gt(12) << " " << state_gt(13) << " ";
+      of_state_gt << state_gt(14) << " " << state_gt(15) << " " << state_gt(16) << " ";
+
+      // TIMEOFF: Get the current true time offset
+      of_state_gt.precision(7);
+      of_state_gt << _sim->get_true_paramters().calib_camimu_dt << " ";
+      of_state_gt.precision(0);
+      of_state_gt << state->_options.num_cameras << " ";
+      of_state_gt.precision(6);
+
+      // CALIBRATION: Write the camera values to file
+      assert(state->_options.num_cameras == _sim->get_true_paramters().state_options.num_cameras);
+      for (int i = 0; i < state->_options.num_cameras; i++) {
+        // Intrinsics values
+        of_state_gt << _sim->get_true_paramters().camera_intrinsics.at(i)(0) << " " << _sim->get_true_paramters().camera_intrinsics.at(i)(1)
+                    << " " << _sim->get_true_paramters().camera_intrinsics.at(i)(2) << " "
+                    << _sim->get_true_paramters().camera_intrinsics.at(i)(3) << " ";
+        of_state_gt << _sim->get_true_paramters().camera_intrinsics.at(i)(4) << " " << _sim->get_true_paramters().camera_intrinsics.at(i)(5)
+                    << " " << _sim->get_true_paramters().camera_intrinsics.at(i)(6) << " "
+                    << _sim->get_true_paramters().camera_intrinsics.at(i)(7) << " ";
+        // Rotation and position
+        of_state_gt << _sim->get_true_paramters().camera_extrinsics.at(i)(0) << " " << _sim->get_true_paramters().camera_extrinsics.at(i)(1)
+                    << " " << _sim->get_true_paramters().camera_extrinsics.at(i)(2) << " "
+                    << _sim->get_true_paramters().camera_extrinsics.at(i)(3) << " ";
+        of_state_gt << _sim->get_true_paramters().camera_extrinsics.at(i)(4) << " " << _sim->get_true_paramters().camera_extrinsics.at(i)(5)
+                    << " " << _sim->get_true_paramters().camera_extrinsics.at(i)(6) << " ";
+      }
+
+      // New line
+      of_state_gt << std::endl;
+    }
+  }
+
+  //==========================================================================
+  //==========================================================================
+  //==========================================================================
+
+  // Get the covariance of the whole system
+  Eigen::MatrixXd cov = StateHelper::get_full_covariance(state);
+
+  // STATE: Write the current state to file
+  of_state_est.precision(5);
+  of_state_est.setf(std::ios::fixed, std::ios::floatfield);
+  of_state_est << timestamp_inI << " ";
+  of_state_est.precision(6);
+  of_state_est << state->_imu->quat()(0) << " " << state->_imu->quat()(1) << " " << state->_imu->quat()(2) << " " << state->_imu->quat()(3)
+               << " ";
+  of_state_est << state->_imu->pos()(0) << " " << state->_imu->pos()(1) << " " << state->_imu->pos()(2) << " ";
+  of_state_est << state->_imu->vel()(0) << " " << state->_imu->vel()(1) << " " << state->_imu->vel()(2) << " ";
+  of_state_est << state->_imu->bias_g()(0) << " " << state->_imu->bias_g()(1) << " " << state->_imu->bias_g()(2) << " ";
+  of_state_est << state->_imu->bias_a()(0) << " " << state->_imu->bias_a()(1) << " " << state->_imu->bias_a()(2) << " ";
+
+  // STATE: Write current uncertainty to file
+  of_state_std.precision(5);
+  of_state_std.setf(std::ios::fixed, std::ios::floatfield);
+  of_state_std << timestamp_inI << " ";
+  of_state_std.precision(6);
+  int id = state->_imu->q()->id();
+  of_state_std << std::sqrt(cov(id + 0, id + 0)) << " " << std::sqrt(cov(id + 1, id + 1)) << " " << std::sqrt(cov(id + 2, id + 2)) << " ";
+  id = state->_imu->p()->id();
+  of_state_std << std::sqrt(cov(id + 0, id + 0)) << " " << std::sqrt(cov(id + 1, id + 1)) << " " << std::sqrt(cov(id + 2, id + 2)) << " ";
+  id = state->_imu->v()->id();
+  of_state_std << std::sqrt(cov(id + 0, id + 0)) << " " << std::sqrt(cov(id + 1, id + 1)) << " " << std::sqrt(cov(id + 2, id + 2)) << " ";
+  id = state->_imu->bg()->id();
+  of_state_std << std::sqrt(cov(id + 0, id + 0)) << " " << std::sqrt(cov(id + 1, id + 1)) << " " << std::sqrt(cov(id + 2, id + 2)) << " ";
+  id = state->_imu->ba()->id();
+  of_state_std << std::sqrt(cov(id + 0, id + 0)) << " " << std::sqrt(cov(id + 1, id + 1)) << " " << std::sqrt(cov(id + 2, id + 2)) << " ";
+
+  // TIMEOFF: Get the current estimate time offset
+  of_state_est.precision(7);
+  of_state_est << state->_calib_dt_CAMtoIMU->value()(0) << " ";
+  of_state_est.precision(0);
+  of_state_est << state->_options.num_cameras << " ";
+  of_state_est.precision(6);
+
+  // TIMEOFF: Get the current std values
+  if (state->_options.do_calib_camera_timeoffset) {
+    of_state_std << std::sqrt(cov(state->_calib_dt_CAMtoIMU->id(), state->_calib_dt_CAMtoIMU->id())) << " ";
+  } else {
+    of_state_std << 0.0 << " ";
+  }
+  of_state_std.precision(0);
+  of_state_std << state->_options.num_cameras << " ";
+  of_state_std.precision(6);
+
+  // CALIBRATION: Write the camera values to file
+  for (int i = 0; i < state->_options.num_cameras; i++) {
+    // Intrinsics values
+    of_state_est << state->_cam_intrinsics.at(i)->value()(0) << " " << state->_cam_intrinsics.at(i)->value()(1) << " "
+                 << state->_cam_intrinsics.at(i)->value()(2) << " " << state->_cam_intrinsics.at(i)->value()(3) << " ";
+    of_state_est << state->_cam_intrinsics.at(i)->value()(4) << " " << state->_cam_intrinsics.at(i)->value()(5) << " "
+                 << state->_cam_intrinsics.at(i)->value()(6) << " " << state->_cam_intrinsics.at(i)->value()(7) << " ";
+    // Rotation and position
+    of_state_est << state->_calib_IMUtoCAM.at(i)->value()(0) << " " << state->_calib_IMUtoCAM.at(i)->value()(1) << " "
+                 << state->_calib_IMUtoCAM.at(i)->value()(2) << " " << state->_calib_IMUtoCAM.at(i)->value()(3) << " ";
+    of_state_est << state->_calib_IMUtoCAM.at(i)->value()(4) << " " << state->_calib_IMUtoCAM.at(i)->value()(5) << " "
+                 << state->_calib_IMUtoCAM.at(i)->value()(6) << " ";
+    // Covariance
+    if (state->_options.do_calib_camera_intrinsics) {
+      int index_in = state->_cam_intrinsics.at(i)->id();
+      of_state_std << std::sqrt(cov(index_in + 0, index_in + 0)) << " " << std::sqrt(cov(index_in + 1, index_in + 1)) << " "
+                   << std::sqrt(cov(index_in + 2, index_in + 2)) << " " << std::sqrt(cov(index_in + 3, index_in + 3)) << " ";
+      of_state_std << std::sqrt(cov(index_in + 4, index_in + 4)) << " " << std::sqrt(cov(index_in + 5, index_in + 5)) << " "
+                   << std::sqrt(cov(index_in + 6, index_in + 6)) << " " << std::sqrt(cov(index_in + 7, index_in + 7)) << " ";
+    } else {
+      of_state_std << 0.0 << " " << 0.0 << " " << 0.0 << " " << 0.0 << " ";
+      of_state_std << 0.0 << " " << 0.0 << " " << 0.0 << " " << 0.0 << " ";
+    }
+    if (state->_options.do_calib_camera_pose) {
+      int index_ex = state->_calib_IMUtoCAM.at(i)->id();
+      of_state_std << std::sqrt(cov(index_ex + 0, index_ex + 0)) << " " << std::sqrt(cov(index_ex + 1, index_ex + 1)) << " "
+                   << std::sqrt(cov(index_ex + 2, index_ex + 2)) << " ";
+      of_state_std << std::sqrt(cov(index_ex + 3, index_ex + 3)) << " " << std::sqrt(cov(index_ex + 4, index_ex + 4)) << " "
+                   << std::sqrt(cov(index_ex + 5, index_ex + 5)) << " ";
+    } else {
+      of_state_std << 0.0 << " " << 0.0 << " " << 0.0 << " ";
+      of_state_std << 0.0 << " " << 0.0 << " " << 0.0 << " ";
+    }
+  }
+
+  // Done with the estimates!
+  of_state_est << std::endl;
+  of_state_std << std::endl;
+}
@@ -0,0 +1,72 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2021 Patrick Geneva
+ * Copyright (C) 2021 Guoquan Huang
+ * Copyright (C) 2021 OpenVINS Contributors
+ * Copyright (C) 2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OV_MSCKF_STATE_RECORDER_H
+#define OV_MSCKF_STATE_RECORDER_H
+
+#include <fstream>
+#include <memory>
+#include <string>
+
+#include "sim/Simulator.h"
+#include "state/State.h"
+
+namespace ov_msckf {
+
+/**
+ * @brief Saves our full state estimate, its uncertainty, and the groundtruth (if simulating) to file.
+ *
+ * Each call to save() appends one line to each file in the format read by ov_eval (e.g. its error_simulation utility).
+ * This has no ROS dependencies so it can be used by both our ROS visualizer and headless simulation drivers.
+ */
+class StateRecorder {
+
+public:
+  /**
+   * @brief Default constructor, will overwrite any existing files and create their directories
+   * @param filepath_est Path of the file our state estimate is saved into
+   * @param filepath_std Path of the file our state standard deviations are saved into
+   * @param filepath_gt Path of the file the groundtruth state is saved into (only used if we have a simulator)
+   * @param sim Simulator we get the groundtruth from (nullptr if we are not simulating)
+   */
+  StateRecorder(const std::string &filepath_est, const std::string &filepath_std, const std::string &filepath_gt,
+                std::shared_ptr<Simulator> sim = nullptr);
+
+  /**
+   * @brief Saves the current state estimate, its standard deviation, and the groundtruth at the same time
+   * @param state State we should save
+   */
+  void save(std::shared_ptr<State> state);
+
+protected:
+  /// Opens a file, deleting anything already there
+  static void open_file(std::ofstream &of, const std::string &filepath);
+
+  /// Simulator (is nullptr if we are not sim'ing)
+  std::shared_ptr<Simulator> _sim;
+
+  /// Files we are saving into
+  std::ofstream of_state_est, of_state_std, of_state_gt;
+};
+
+} // namespace ov_msckf
+
+#endif // OV_MSCKF_STATE_RECORDER_H
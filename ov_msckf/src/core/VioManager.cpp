@@ -24,7 +24,6 @@
 #include "types/Landmark.h"
 #include <memory>
 #include <ros/ros.h>
-#include <LocalCartesian.hpp>
 
 using namespace ov_core;
 using namespace ov_type;
@@ -34,20 +33,32 @@ using namespace ov_msckf;
 
 VioManager::VioManager(VioManagerOptions &params_) {
 
-  ros::NodeHandle nh;
+  // Only publish our paths and odometry if we are a ROS node and have a master to advertise them to
+  // NOTE: advertising waits for the master, so headless users (e.g. batch simulations) should not call ros::init()
+  if (ros::isInitialized() && ros::master::check()) {
 
-  gps_path_pub = nh.advertise<nav_msgs::Path>("gps_path", 10);
+    ros::NodeHandle nh;
 
-  vio_path_pub = nh.advertise<nav_msgs::Path>("vio_path", 10);
+    gps_path = std::make_shared<PathPublisher>(nh, "gps_path", "global", params_.path_max_length, params_.path_min_distance,
+                                               params_.path_min_dt);
 
-  vio_to_gps_pub = nh.advertise<nav_msgs::Path>("vio_to_gps_path", 10);
+    vio_path = std::make_shared<PathPublisher>(nh, "vio_path", "global", params_.path_max_length, params_.path_min_distance,
+                                               params_.path_min_dt);
 
-  odom_vio_cam_rate_pub = nh.advertise<nav_msgs::Odometry>("odom_vio/cam_rate", 10);
-  odom_vio_imu_rate_pub = nh.advertise<nav_msgs::Odometry>("odom_vio/imu_rate", 10);
+    vio_to_gps_path = std::make_shared<PathPublisher>(nh, "vio_to_gps_path", "global", params_.path_max_length,
+                                                      params_.path_min_distance, params_.path_min_dt);
+
+    odom_vio_cam_rate_pub = nh.advertise<nav_msgs::Odometry>("odom_vio/cam_rate", 10);
+    odom_vio_imu_rate_pub = nh.advertise<nav_msgs::Odometry>("odom_vio/imu_rate", 10);
+  }
 
 
-  file_state.open("/home/anand/openvins_output/state.txt");
-  file_gps.open("/home/anand/openvins_output/gps.txt");
+  // Log the GPS fixes and our state at each fix if we have somewhere to log them
+  size_t log_max_file_bytes = (size_t)std::max(params_.log_max_file_mb, 0) * 1024 * 1024;
+  if (!params_.log_directory.empty()) {
+    log_state = std::make_shared<AsyncLogger>(params_.log_directory, "state", "txt", "", log_max_file_bytes, params_.log_max_files);
+    log_gps = std::make_shared<AsyncLogger>(params_.log_directory, "gps", "txt", "", log_max_file_bytes, params_.log_max_files);
+  }
 
 
 
@@ -90,6 +101,15 @@ VioManager::VioManager(VioManagerOptions &params_) {
       state->_cam_intrinsics_cameras.at(i)->set_value(params.camera_intrinsics.at(i));
     }
 
+    // Precompute the undistortion of each pixel if enabled
+    // NOTE: with online intrinsic calibration the table would need to be rebuilt after every update, so we do not use it then
+    if (params.use_undistort_table && state->_options.do_calib_camera_intrinsics) {
+      if (i == 0)
+        printf(YELLOW "[TRACK]: undistort table disabled as we are calibrating the camera intrinsics online\n" RESET);
+    } else if (params.use_undistort_table) {
+      state->_cam_intrinsics_cameras.at(i)->set_undistort_table(params.camera_wh.at(i).first, params.camera_wh.at(i).second);
+    }
+
     // Camera intrinsic properties
     state->_cam_intrinsics.at(i)->set_value(params.camera_intrinsics.at(i));
     state->_cam_intrinsics.at(i)->set_fej(params.camera_intrinsics.at(i));
@@ -99,28 +119,31 @@ VioManager::VioManager(VioManagerOptions &params_) {
     state->_calib_IMUtoCAM.at(i)->set_fej(params.camera_extrinsics.at(i));
   }
 
+  // GPS lever arm, and our global frame in the GPS ENU frame (our origin starts at the first fix)
+  state->_calib_IMUtoGPS->set_value(params.gps_leverarm);
+  state->_calib_IMUtoGPS->set_fej(params.gps_leverarm);
+  Eigen::VectorXd temp_GtoENU = Eigen::VectorXd::Zero(4);
+  temp_GtoENU(0) = params.gps_yaw_GtoENU;
+  state->_calib_GtoENU->set_value(temp_GtoENU);
+  state->_calib_GtoENU->set_fej(temp_GtoENU);
+
   //===================================================================================
   //===================================================================================
   //===================================================================================
 
   // If we are recording statistics, then open our file
+  // NOTE: the logger will overwrite any old file and create the directory it is in
   if (params.record_timing_information) {
-    // If the file exists, then delete it
-    if (boost::filesystem::exists(params.record_timing_filepath)) {
-      boost::filesystem::remove(params.record_timing_filepath);
-      printf(YELLOW "[STATS]: found old file found, deleted...\n" RESET);
-    }
-    // Create the directory that we will open the file in
     boost::filesystem::path p(params.record_timing_filepath);
-    boost::filesystem::create_directories(p.parent_path());
-    // Open our statistics file!
-    of_statistics.open(params.record_timing_filepath, std::ofstream::out | std::ofstream::app);
-    // Write the header information into it
-    of_statistics << "# timestamp (sec),tracking,propagation,msckf update,";
+    std::string header = "# timestamp (sec),tracking,propagation,msckf update,";
     if (state->_options.max_slam_features > 0) {
-      of_statistics << "slam update,slam delayed,";
+      header += "slam update,slam delayed,";
     }
-    of_statistics << "re-tri & marg,total" << std::endl;
+    header += "re-tri & marg,total";
+    std::string extension = p.extension().string();
+    of_statistics = std::make_shared<AsyncLogger>(p.has_parent_path() ? p.parent_path().string() : ".", p.stem().string(),
+                                                  extension.empty() ? "" : extension.substr(1), header, log_max_file_bytes,
+                                                  params.log_max_files);
   }
 
   //===================================================================================
@@ -130,9 +153,11 @@ VioManager::VioManager(VioManagerOptions &params_) {
   // Lets make a feature extractor
   trackDATABASE = std::make_shared<FeatureDatabase>();
   if (params.use_klt) {
-    trackFEATS = std::shared_ptr<TrackBase>(new TrackKLT(state->_cam_intrinsics_cameras, params.num_pts, state->_options.max_aruco_features,
-                                                         params.use_stereo, params.histogram_method, params.fast_threshold, params.grid_x,
-                                                         params.grid_y, params.min_px_dist));
+    std::shared_ptr<TrackKLT> trackKLT = std::shared_ptr<TrackKLT>(
+        new TrackKLT(state->_cam_intrinsics_cameras, params.num_pts, state->_options.max_aruco_features, params.use_stereo,
+                     params.histogram_method, params.fast_threshold, params.grid_x, params.grid_y, params.min_px_dist));
+    trackKLT->set_prediction_params(params.klt_pred_pyr_levels, params.klt_pred_max_iters);
+    trackFEATS = trackKLT;
   } else {
     trackFEATS = std::shared_ptr<TrackBase>(new TrackDescriptor(
         state->_cam_intrinsics_cameras, params.num_pts, state->_options.max_aruco_features, params.use_stereo, params.histogram_method,
@@ -145,11 +170,32 @@ VioManager::VioManager(VioManagerOptions &params_) {
                                                            params.use_stereo, params.histogram_method, params.downsize_aruco));
   }
 
+  // Our trackers record the measurements they add, so only these new ones need to be appended into our other databases
+  trackFEATS->get_feature_database()->set_record_new_measurements(true);
+  if (trackARUCO != nullptr) {
+    trackARUCO->get_feature_database()->set_record_new_measurements(true);
+  }
+
+  // The feature databases our estimator will use
+  // If we are tracking asynchronously, then the estimator has its own copy which the new measurements are appended to
+  // Otherwise we can just directly use the tracker databases since everything is serial
+  if (params.use_async_tracking) {
+    databaseFEATS = std::make_shared<FeatureDatabase>();
+    databaseARUCO = (trackARUCO != nullptr) ? std::make_shared<FeatureDatabase>() : nullptr;
+  } else {
+    databaseFEATS = trackFEATS->get_feature_database();
+    databaseARUCO = (trackARUCO != nullptr) ? trackARUCO->get_feature_database() : nullptr;
+  }
+
+  // Buffer of inertial readings, shared between our propagator, initializer and zero velocity updater
+  // Needs to hold at least three initialization windows for our initializer
+  std::shared_ptr<ImuBuffer> imu_buffer = std::make_shared<ImuBuffer>(std::max(10.0, 3 * params.init_window_time));
+
   // Initialize our state propagator
-  propagator = std::make_shared<Propagator>(params.imu_noises, params.gravity_mag);
+  propagator = std::make_shared<Propagator>(params.imu_noises, params.gravity_mag, imu_buffer);
 
   // Our state initialize
-  initializer = std::make_shared<InertialInitializer>(params.gravity_mag, params.init_window_time, params.init_imu_thresh);
+  initializer = std::make_shared<InertialInitializer>(params.gravity_mag, params.init_window_time, params.init_imu_thresh, imu_buffer);
 
   // Make the updater!
   updaterMSCKF = std::make_shared<UpdaterMSCKF>(params.msckf_options, params.featinit_options);
@@ -157,7 +203,7 @@ VioManager::VioManager(VioManagerOptions &params_) {
 
   // If we are using zero velocity updates, then create the updater
   if (params.try_zupt) {
-    updaterZUPT = std::make_shared<UpdaterZeroVelocity>(params.zupt_options, params.imu_noises, trackFEATS->get_feature_database(),
+    updaterZUPT = std::make_shared<UpdaterZeroVelocity>(params.zupt_options, params.imu_noises, databaseFEATS,
                                                         propagator, params.gravity_mag, params.zupt_max_velocity,
                                                         params.zupt_noise_multiplier, params.zupt_max_disparity);
   }
@@ -165,37 +211,52 @@ VioManager::VioManager(VioManagerOptions &params_) {
   // Feature initializer for active tracks
   active_tracks_initializer = std::make_shared<FeatureInitializer>(params.featinit_options);
 
-  I_p_Gps << 0, 0, 0;
+  chi_squared_table_gps = ChiSquaredTable::get(params.gps_options.chi2_confidence);
+  gps_frontend = std::make_shared<GpsFrontend>();
+  latest_gps_data.timestamp = -1;
+
+  // Finally start our feature tracking thread if we are tracking asynchronously
+  // NOTE: the tracker undistorts using the same camera objects our online intrinsic calibration updates in each EKF update
+  // NOTE: thus we can not track in another thread while calibrating them, as the tracker would read them while they are written
+  if (params.use_async_tracking) {
+    if (state->_options.do_calib_camera_intrinsics) {
+      printf(RED "[TRACK]: async tracking can not be used with online camera intrinsic calibration!\n" RESET);
+      printf(RED "[TRACK]: please disable either async_tracking or calib_cam_intrinsics\n" RESET);
+      std::exit(EXIT_FAILURE);
+    }
+    async_running = true;
+    async_thread = std::thread(&VioManager::run_async_tracking, this);
+  }
+}
 
+VioManager::~VioManager() {
 
+  // Stop our tracking thread, it will exit once it finishes its current frame
+  if (async_thread.joinable()) {
+    {
+      std::unique_lock<std::mutex> lck(async_mtx);
+      async_running = false;
+    }
+    async_cv_input.notify_all();
+    async_cv_output.notify_all();
+    async_cv_estimator.notify_all();
+    async_thread.join();
+  }
 }
 
 void VioManager::feed_measurement_imu(const ov_core::ImuData &message) {
 
   // Push back to our propagator
+  // NOTE: our initializer and zero velocity updater share the propagator's buffer of readings
   // 将IMU数据放入容器
   propagator->feed_imu(message);
 
-  // Push back to our initializer
-  if (!is_initialized_vio) {
-    // 将IMU数据放入初始化器
-    initializer->feed_imu(message);
-    
-  }
-
-  // Push back to the zero velocity updater if we have it
-  if (updaterZUPT != nullptr) {
-    // 将IMU数据放入zupt更新器
-    updaterZUPT->feed_imu(message);
-  }
-
   // Count how many unique image streams
   std::vector<int> unique_cam_ids;
-  for (const auto &cam_msg : camera_queue) {
-    if (std::find(unique_cam_ids.begin(), unique_cam_ids.end(), cam_msg.sensor_ids.at(0)) != unique_cam_ids.end())
-      continue;
-    unique_cam_ids.push_back(cam_msg.sensor_ids.at(0));
-  }
+  camera_queue.for_each([&](const ov_core::CameraData &cam_msg) {
+    if (std::find(unique_cam_ids.begin(), unique_cam_ids.end(), cam_msg.sensor_ids.at(0)) == unique_cam_ids.end())
+      unique_cam_ids.push_back(cam_msg.sensor_ids.at(0));
+  });
 
   // If we do not have enough unique cameras then we need to wait
   // We should wait till we have one of each camera to ensure we propagate in the correct order
@@ -207,23 +268,40 @@ void VioManager::feed_measurement_imu(const ov_core::ImuData &message) {
   // Loop through our queue and see if we are able to process any of our camera measurements
   // We are able to process if we have at least one IMU measurement greater then the camera time
   double timestamp_inC = message.timestamp - state->_calib_dt_CAMtoIMU->value()(0);
-  while (!camera_queue.empty() && camera_queue.at(0).timestamp < timestamp_inC) {
-    track_image_and_update(camera_queue.at(0));
-    camera_queue.pop_front();
+  // If we are tracking asynchronously, then we pass it to our tracking thread and update with any frames it has finished
+  // Thus the tracking of this new image can happen while we are doing the update of the last one
+  if (params.use_async_tracking) {
+    ov_core::CameraData cam_msg;
+    while (camera_queue.pop_before(timestamp_inC, cam_msg)) {
+      predict_camera_rotations(cam_msg);
+      push_async_tracking(cam_msg);
+    }
+    process_async_tracked_frames();
+  } else {
+    ov_core::CameraData cam_msg;
+    while (camera_queue.pop_before(timestamp_inC, cam_msg)) {
+      predict_camera_rotations(cam_msg);
+      track_image_and_update(cam_msg);
+    }
   }
 
 
   // Loop through out queue and see if we are able to process any of our gps measurements
-  while (!gps_queue.empty() && gps_queue.at(0).timestamp < timestamp_inC){
+  // If we are fusing the fixes at our clones, then we need to wait till we have a clone after the fix
+  // Thus fixes delayed by less than our clone window will still be fused at their own time
+  double timestamp_gps = timestamp_inC;
+  if (params.gps_use_clones && is_initialized_vio)
+    timestamp_gps = std::min(timestamp_gps, state->_timestamp + params.gps_clone_max_dt);
+  ov_core::GpsData gps_msg;
+  while (gps_queue.pop_before(timestamp_gps, gps_msg)){
     // std::cout << "track gps and update" << std::endl;
     ROS_INFO("Track gps and update");
-    // std::cout << gps_queue.at(0).timestamp << std::endl;
-    track_gps_and_update(gps_queue.at(0));
-    gps_queue.pop_front();
+    // std::cout << gps_msg.timestamp << std::endl;
+    track_gps_and_update(gps_msg);
   }
 
   // Publish odometry at IMU frequency (after all processing)
-  publish_odometry(message.timestamp, odom_vio_imu_rate_pub);
+  publish_odometry(message.timestamp, odom_vio_imu_rate_pub, true);
 
   // std::cout << gps_queue.size() << std::endl;
 
@@ -242,6 +320,8 @@ void VioManager::feed_measurement_simulation(double timestamp, const std::vector
     // Replace with the simulated tracker
     trackSIM = std::make_shared<TrackSIM>(state->_cam_intrinsics_cameras, state->_options.max_aruco_features);
     trackFEATS = trackSIM;
+    trackSIM->get_feature_database()->set_record_new_measurements(true);
+    databaseFEATS = trackSIM->get_feature_database();
     printf(RED "[SIM]: casting our tracker to a TrackSIM object!\n" RESET);
   }
   trackSIM->set_width_height(params.camera_wh);
@@ -321,11 +401,55 @@ void VioManager::track_gps_and_update(const ov_core::GpsData &message_const)
 }
 
 
+void VioManager::predict_camera_rotations(ov_core::CameraData &message) {
+
+  // Nothing to do if our tracker will not use it
+  message.R_lasttocurr.clear();
+  if (!params.use_klt || !params.use_klt_prediction)
+    return;
+
+  // Integrate the gyroscope since the last image of each camera, and rotate this into the camera frame
+  // R_CktoCk1 = R_ItoC * R_IktoIk1 * R_ItoC^T
+  double t_off = state->_calib_dt_CAMtoIMU->value()(0);
+  bool have_all = true;
+  std::vector<Eigen::Matrix3d> rotations;
+  for (size_t i = 0; i < message.sensor_ids.size(); i++) {
+    int cam_id = message.sensor_ids.at(i);
+    Eigen::Matrix3d R_IktoIk1;
+    auto it = camera_last_timestamp.find(cam_id);
+    if (it == camera_last_timestamp.end() ||
+        !propagator->integrate_rotation(it->second + t_off, message.timestamp + t_off, state->_imu->bias_g(), R_IktoIk1)) {
+      have_all = false;
+    } else {
+      Eigen::Matrix3d R_ItoC = state->_calib_IMUtoCAM.at(cam_id)->Rot();
+      rotations.push_back(R_ItoC * R_IktoIk1 * R_ItoC.transpose());
+    }
+    camera_last_timestamp[cam_id] = message.timestamp;
+  }
+  if (have_all)
+    message.R_lasttocurr = rotations;
+}
+
 void VioManager::track_image_and_update(const ov_core::CameraData &message_const) {
 
   // Start timing
   rT1 = boost::posix_time::microsec_clock::local_time();
 
+  // Perform our feature tracking!
+  // LK光流跟踪
+  ov_core::CameraData message = track_image(message_const);
+  trackDATABASE->append_new_measurements(trackFEATS->get_feature_database());
+  if (trackARUCO != nullptr) {
+    trackDATABASE->append_new_measurements(trackARUCO->get_feature_database());
+  }
+  rT2 = boost::posix_time::microsec_clock::local_time();
+
+  // Call on our zero velocity, initialization, and propagate and update logic
+  update_with_tracked_image(message);
+}
+
+ov_core::CameraData VioManager::track_image(const ov_core::CameraData &message_const) {
+
   // Assert we have valid measurement data and ids
   assert(!message_const.sensor_ids.empty());
   assert(message_const.sensor_ids.size() == message_const.images.size());
@@ -343,24 +467,141 @@ void VioManager::track_image_and_update(const ov_core::CameraData &message_const
     message.images.at(i) = img_temp;
   }
 
-  // Record our latest image for displaying out zero velocity update
-  for (size_t i = 0; i < message.sensor_ids.size(); i++) {
-    zupt_img_last[message.sensor_ids.at(i)] = message.images.at(i).clone();
-  }
-
   // Perform our feature tracking!
-  // LK光流跟踪
   trackFEATS->feed_new_camera(message);
-  trackDATABASE->append_new_measurements(trackFEATS->get_feature_database());
 
   // If the aruco tracker is available, the also pass to it
   // NOTE: binocular tracking for aruco doesn't make sense as we by default have the ids
   // NOTE: thus we just call the stereo tracking if we are doing binocular!
   if (trackARUCO != nullptr) {
     trackARUCO->feed_new_camera(message);
-    trackDATABASE->append_new_measurements(trackARUCO->get_feature_database());
   }
+  return message;
+}
+
+void VioManager::push_async_tracking(const ov_core::CameraData &message) {
+
+  // If the tracker has fallen behind we either wait for it, or drop the oldest image it has not tracked yet
+  // While waiting we process any frames it has finished, as it may itself be waiting for us to take them
+  std::unique_lock<std::mutex> lck(async_mtx);
+  while ((int)async_queue_input.size() >= params.async_tracking_queue_size) {
+    if (params.async_tracking_policy == VioManagerOptions::DROP_OLDEST) {
+      printf(YELLOW "[TRACK]: tracker is falling behind, dropping image %.3f\n" RESET, async_queue_input.front().timestamp);
+      async_queue_input.pop_front();
+    } else if (!async_queue_output.empty()) {
+      lck.unlock();
+      process_async_tracked_frames();
+      lck.lock();
+    } else {
+      async_cv_estimator.wait(lck, [&] {
+        return !async_running || (int)async_queue_input.size() < params.async_tracking_queue_size || !async_queue_output.empty();
+      });
+      if (!async_running)
+        return;
+    }
+  }
+  async_queue_input.push_back(message);
+  lck.unlock();
+  async_cv_input.notify_one();
+}
+
+void VioManager::process_async_tracked_frames() {
+
+  // Take all frames the tracker has finished, and let it continue if it was waiting for us
+  std::deque<std::shared_ptr<TrackedFrame>> frames;
+  {
+    std::unique_lock<std::mutex> lck(async_mtx);
+    frames.swap(async_queue_output);
+  }
+  async_cv_output.notify_one();
+  for (const auto &frame : frames) {
+    process_tracked_frame(frame);
+  }
+}
+
+void VioManager::run_async_tracking() {
+
+  while (true) {
+
+    // Wait for a new camera message to track
+    ov_core::CameraData message;
+    {
+      std::unique_lock<std::mutex> lck(async_mtx);
+      async_cv_input.wait(lck, [&] { return !async_running || !async_queue_input.empty(); });
+      if (!async_running)
+        return;
+      message = async_queue_input.front();
+      async_queue_input.pop_front();
+    }
+    async_cv_estimator.notify_one();
+
+    // Track it, and extract what new measurements we got
+    boost::posix_time::ptime rT1_async = boost::posix_time::microsec_clock::local_time();
+    std::shared_ptr<TrackedFrame> frame = std::make_shared<TrackedFrame>();
+    frame->message = track_image(message);
+    frame->feats = trackFEATS->get_feature_database()->take_new_measurements();
+    if (trackARUCO != nullptr) {
+      frame->aruco = trackARUCO->get_feature_database()->take_new_measurements();
+    }
+    boost::posix_time::ptime rT2_async = boost::posix_time::microsec_clock::local_time();
+    frame->time_track = (rT2_async - rT1_async).total_microseconds() * 1e-6;
+
+    // Our tracker databases only need to hold measurements the estimator has not marginalized yet
+    // NOTE: the estimator has its own copy of all measurements, so these are only used for visualization
+    // NOTE: the visualization only draws copies of these features, so it is safe to clean them up while it runs
+    double time_cleanup = async_cleanup_time;
+    if (time_cleanup > 0) {
+      trackFEATS->get_feature_database()->cleanup_measurements(time_cleanup);
+      if (trackARUCO != nullptr) {
+        trackARUCO->get_feature_database()->cleanup_measurements(time_cleanup);
+      }
+    }
+
+    // Finally pass it to the estimator
+    // If the estimator has fallen behind we either wait for it, or drop the oldest frame it has not processed
+    {
+      std::unique_lock<std::mutex> lck(async_mtx);
+      if (params.async_tracking_policy == VioManagerOptions::BLOCK) {
+        async_cv_output.wait(lck, [&] { return !async_running || (int)async_queue_output.size() < params.async_tracking_queue_size; });
+        if (!async_running)
+          return;
+      } else {
+        while ((int)async_queue_output.size() >= params.async_tracking_queue_size) {
+          printf(YELLOW "[TRACK]: estimator is falling behind, dropping tracked frame %.3f\n" RESET,
+                 async_queue_output.front()->message.timestamp);
+          async_queue_output.pop_front();
+        }
+      }
+      async_queue_output.push_back(frame);
+    }
+    async_cv_estimator.notify_one();
+  }
+}
+
+void VioManager::process_tracked_frame(const std::shared_ptr<TrackedFrame> &frame) {
+
+  // Timing of our tracking is what the tracking thread took
   rT2 = boost::posix_time::microsec_clock::local_time();
+  rT1 = rT2 - boost::posix_time::microseconds((long)(frame->time_track * 1e6));
+
+  // Append the new measurements to our estimator and history databases
+  databaseFEATS->append_measurements(frame->feats);
+  trackDATABASE->append_measurements(frame->feats);
+  if (databaseARUCO != nullptr) {
+    databaseARUCO->append_measurements(frame->aruco);
+    trackDATABASE->append_measurements(frame->aruco);
+  }
+
+  // Call on our zero velocity, initialization, and propagate and update logic
+  update_with_tracked_image(frame->message);
+}
+
+void VioManager::update_with_tracked_image(const ov_core::CameraData &message) {
+
+  // Record our latest image for displaying out zero velocity update
+  for (size_t i = 0; i < message.sensor_ids.size(); i++) {
+    zupt_img_last[message.sensor_ids.at(i)] = message.images.at(i).clone();
+  }
 
   // Check if we should do zero-velocity, if so update the state with it
   // Note that in the case that we only use in the beginning initialization phase
@@ -406,12 +647,12 @@ void VioManager::track_image_and_update(const ov_core::CameraData &message_const
   if (!is_initialized_vio) {
     is_initialized_vio = try_to_initialize();
 
-    while(!gps_queue.empty())
-    {
-      // 第一个gps数据
-      latest_gps_data = gps_queue.at(0);
-      gps_queue.pop_front();
+    // 第一个gps数据
+    // The last fix before we initialize is the origin of our ENU frame
+    while (gps_queue.pop(latest_gps_data)) {
     }
+    if (is_initialized_vio && latest_gps_data.timestamp >= 0)
+      gps_frontend->set_origin(latest_gps_data.lla);
 
     if (!is_initialized_vio)
       return;
@@ -444,7 +685,7 @@ void VioManager::do_feature_propagate_update(const ov_core::CameraData &message)
   rT3 = boost::posix_time::microsec_clock::local_time();
 
   // Publish odometry after propagation (at camera rate when propagation occurs)
-  publish_odometry(message.timestamp, odom_vio_cam_rate_pub);
+  publish_odometry(message.timestamp, odom_vio_cam_rate_pub, false);
 
   // If we have not reached max clones, we should just return...
   // This isn't super ideal, but it keeps the logic after this easier...
@@ -469,13 +710,13 @@ void VioManager::do_feature_propagate_update(const ov_core::CameraData &message)
   // Now, lets get all features that should be used for an update that are lost in the newest frame
   // We explicitly request features that have not been deleted (used) in another update step
   std::vector<std::shared_ptr<Feature>> feats_lost, feats_marg, feats_slam;
-  feats_lost = trackFEATS->get_feature_database()->features_not_containing_newer(state->_timestamp, false, true);
+  feats_lost = databaseFEATS->features_not_containing_newer(state->_timestamp, false, true);
 
   // Don't need to get the oldest features until we reach our max number of clones
   if ((int)state->_clones_IMU.size() > state->_options.max_clone_size) {
-    feats_marg = trackFEATS->get_feature_database()->features_containing(state->margtimestep(), false, true);
-    if (trackARUCO != nullptr && message.timestamp - startup_time >= params.dt_slam_delay) {
-      feats_slam = trackARUCO->get_feature_database()->features_containing(state->margtimestep(), false, true);
+    feats_marg = databaseFEATS->features_containing(state->margtimestep(), false, true);
+    if (databaseARUCO != nullptr && message.timestamp - startup_time >= params.dt_slam_delay) {
+      feats_slam = databaseARUCO->features_containing(state->margtimestep(), false, true);
     }
   }
 
@@ -560,12 +801,12 @@ void VioManager::do_feature_propagate_update(const ov_core::CameraData &message)
   // Note: we only enforce this if the current camera message is where the feature was seen from
   // Note: if you do not use FEJ, these types of slam features *degrade* the estimator performance....
   for (std::pair<const size_t, std::shared_ptr<Landmark>> &landmark : state->_features_SLAM) {
-    if (trackARUCO != nullptr) {
-      std::shared_ptr<Feature> feat1 = trackARUCO->get_feature_database()->get_feature(landmark.second->_featid);
+    if (databaseARUCO != nullptr) {
+      std::shared_ptr<Feature> feat1 = databaseARUCO->get_feature(landmark.second->_featid);
       if (feat1 != nullptr)
         feats_slam.push_back(feat1);
     }
-    std::shared_ptr<Feature> feat2 = trackFEATS->get_feature_database()->get_feature(landmark.second->_featid);
+    std::shared_ptr<Feature> feat2 = databaseFEATS->get_feature(landmark.second->_featid);
     if (feat2 != nullptr)
       feats_slam.push_back(feat2);
     assert(landmark.second->_unique_camera_id != -1);
@@ -674,9 +915,9 @@ void VioManager::do_feature_propagate_update(const ov_core::CameraData &message)
   // Remove features that where used for the update from our extractors at the last timestep
   // This allows for measurements to be used in the future if they failed to be used this time
   // Note we need to do this before we feed a new image, as we want all new measurements to NOT be deleted
-  trackFEATS->get_feature_database()->cleanup();
-  if (trackARUCO != nullptr) {
-    trackARUCO->get_feature_database()->cleanup();
+  databaseFEATS->cleanup();
+  if (databaseARUCO != nullptr) {
+    databaseARUCO->cleanup();
   }
 
   // First do anchor change if we are about to lose an anchor pose
@@ -684,11 +925,12 @@ void VioManager::do_feature_propagate_update(const ov_core::CameraData &message)
 
   // Cleanup any features older then the marginalization time
   if ((int)state->_clones_IMU.size() > state->_options.max_clone_size) {
-    trackFEATS->get_feature_database()->cleanup_measurements(state->margtimestep());
+    databaseFEATS->cleanup_measurements(state->margtimestep());
     trackDATABASE->cleanup_measurements(state->margtimestep());
-    if (trackARUCO != nullptr) {
-      trackARUCO->get_feature_database()->cleanup_measurements(state->margtimestep());
+    if (databaseARUCO != nullptr) {
+      databaseARUCO->cleanup_measurements(state->margtimestep());
     }
+    async_cleanup_time = state->margtimestep();
   }
 
   // Finally marginalize the oldest clone if needed
@@ -724,19 +966,19 @@ void VioManager::do_feature_propagate_update(const ov_core::CameraData &message)
   // printf(")\n" RESET);
 
   // Finally if we are saving stats to file, lets save it to file
-  if (params.record_timing_information && of_statistics.is_open()) {
+  // NOTE: this is written to disk by the logger's thread, so we do not wait on it here
+  if (params.record_timing_information && of_statistics != nullptr) {
     // We want to publish in the IMU clock frame
     // The timestamp in the state will be the last camera time
     double t_ItoC = state->_calib_dt_CAMtoIMU->value()(0);
     double timestamp_inI = state->_timestamp + t_ItoC;
     // Append to the file
-    of_statistics << std::fixed << std::setprecision(15) << timestamp_inI << "," << std::fixed << std::setprecision(5) << time_track << ","
-                  << time_prop << "," << time_msckf << ",";
     if (state->_options.max_slam_features > 0) {
-      of_statistics << time_slam_update << "," << time_slam_delay << ",";
+      of_statistics->log("%.15f,%.5f,%.5f,%.5f,%.5f,%.5f,%.5f,%.5f", timestamp_inI, time_track, time_prop, time_msckf, time_slam_update,
+                         time_slam_delay, time_marg, time_total);
+    } else {
+      of_statistics->log("%.15f,%.5f,%.5f,%.5f,%.5f,%.5f", timestamp_inI, time_track, time_prop, time_msckf, time_marg, time_total);
     }
-    of_statistics << time_marg << "," << time_total << std::endl;
-    of_statistics.flush();
   }
 
   // Update our distance traveled
@@ -814,10 +1056,11 @@ bool VioManager::try_to_initialize() {
   StateHelper::fix_4dof_gauge_freedoms(state, q_GtoI0);
 
   // Cleanup any features older then the initialization time
-  trackFEATS->get_feature_database()->cleanup_measurements(state->_timestamp);
-  if (trackARUCO != nullptr) {
-    trackARUCO->get_feature_database()->cleanup_measurements(state->_timestamp);
+  databaseFEATS->cleanup_measurements(state->_timestamp);
+  if (databaseARUCO != nullptr) {
+    databaseARUCO->cleanup_measurements(state->_timestamp);
   }
+  async_cleanup_time = state->_timestamp;
 
   // Else we are good to go, print out our stats
   printf(GREEN "[INIT]: orientation = %.4f, %.4f, %.4f, %.4f\n" RESET, state->_imu->quat()(0), state->_imu->quat()(1),
@@ -1005,58 +1248,26 @@ void VioManager::retriangulate_active_tracks(const ov_core::CameraData &message)
 }
 
 
-Eigen::Vector3d VioManager::ConvertLonLatHeiToENU(const Eigen::Vector3d &init_long_lat_hei, const Eigen::Vector3d &point_long_lat_hei)
-{
-  Eigen::Vector3d point_enu;
-  static GeographicLib::LocalCartesian local_cartesian;
-
-  // static double latitude = 31.3211342333;
-  // static double longitude = 120.67211355;
-  // static double altitude = 0.0;
-
-  // local_cartesian.Reset(latitude, longitude, altitude);
-
-
-  local_cartesian.Reset(init_long_lat_hei(1), init_long_lat_hei(0), init_long_lat_hei(2));
-  local_cartesian.Forward(point_long_lat_hei(1), point_long_lat_hei(0), point_long_lat_hei(2), point_enu.data()[0], point_enu.data()[1], point_enu.data()[2]);
-  return point_enu;
-}
-
 bool VioManager::update_state(const ov_core::GpsData message, std::shared_ptr<State> state)
 {
 
-  Eigen::Vector3d G_p_Gps = ConvertLonLatHeiToENU(latest_gps_data.lla, message.lla);
-
-
-  file_gps << std::fixed << std::setprecision(6) << G_p_Gps[0] << " " << G_p_Gps[1] << " " << G_p_Gps[2] << std::endl;
-  file_state << std::fixed << std::setprecision(6) << state->_imu->pos()(0) << " " << state->_imu->pos()(1) << " " << state->_imu->pos()(2) << std::endl;
-
-  Eigen::Matrix3d gps_to_vio_r;
-  Eigen::Matrix3d vio_to_gps_r;
-
-
-  // gps_to_vio_r <<  -0.703281,  -0.710912,      0,
-  //                   0.710912,  -0.703281,      0,
-  //                   0,          0,             1;       
-
-  // vio_to_gps_r <<  -0.703281,   0.710912,      0,
-  //                  -0.710912,  -0.703281,      0,
-  //                   0,          0,             1;
-
-  gps_to_vio_r <<  1,  0,  0,
-                   0,  1,  0,
-                   0,  0,  1;
+  // If we did not have any fixes before initializing, then this first fix is the origin of our ENU frame
+  if (!gps_frontend->has_origin()) {
+    latest_gps_data = message;
+    gps_frontend->set_origin(message.lla);
+  }
+  Eigen::Vector3d G_p_Gps;
+  gps_frontend->to_enu(message.lla, G_p_Gps);
 
-  vio_to_gps_r <<  1,  0,  0,
-                   0,  1,  0,
-                   0,  0,  1;
 
-  
-  gps_path.header.frame_id = "global";
-  gps_path.header.stamp = ros::Time::now();
+  if (log_gps != nullptr && log_state != nullptr) {
+    log_gps->log("%.6f %.6f %.6f", G_p_Gps[0], G_p_Gps[1], G_p_Gps[2]);
+    log_state->log("%.6f %.6f %.6f", state->_imu->pos()(0), state->_imu->pos()(1), state->_imu->pos()(2));
+  }
 
   geometry_msgs::PoseStamped pose;
-  pose.header = gps_path.header;
+  pose.header.stamp = ros::Time(message.timestamp);
+  pose.header.frame_id = "global";
 
   pose.pose.position.x = G_p_Gps[0];
   pose.pose.position.y = G_p_Gps[1];
@@ -1067,64 +1278,62 @@ bool VioManager::update_state(const ov_core::GpsData message, std::shared_ptr<St
   pose.pose.orientation.z = 0;
   pose.pose.orientation.w = 1;
 
-  gps_path.poses.push_back(pose);
-
-  gps_path_pub.publish(gps_path);
-
-
-  // std::cout << G_p_Gps.transpose() << std::endl;
-
-  Eigen::Vector3d res;
-  Eigen::Matrix<double, 3, 15> H;
-  H.setZero();
+  if (gps_path != nullptr)
+    gps_path->append(pose);
 
+  // Get the IMU pose at the time of this fix, and which variables (with what weight) it depends on
+  // By default this is the current IMU state, otherwise we interpolate between the clones around the fix time
+  std::vector<std::pair<std::shared_ptr<PoseJPL>, double>> gps_clones;
   Eigen::Matrix<double, 3, 3> R_Gtoi = state->_imu->Rot();
   Eigen::Vector3d G_p_i = state->_imu->pos();
-  
-  Eigen::Vector3d exp_G_p_Gps = state->_imu->pos() + R_Gtoi.transpose() * I_p_Gps;
-
-  Eigen::Vector3d exp_VIO_p_Gps = gps_to_vio_r * G_p_Gps;
+  if (params.gps_use_clones) {
+    if (!get_gps_clones(message.timestamp, gps_clones)) {
+      printf(YELLOW "[GPS]: fix at %.3f is outside of our clone window, skipping it!\n" RESET, message.timestamp);
+      return false;
+    }
+    if (gps_clones.size() == 1) {
+      R_Gtoi = gps_clones.at(0).first->Rot();
+      G_p_i = gps_clones.at(0).first->pos();
+    } else {
+      double lambda = gps_clones.at(1).second;
+      Eigen::Matrix3d R_0 = gps_clones.at(0).first->Rot();
+      Eigen::Matrix3d R_1 = gps_clones.at(1).first->Rot();
+      R_Gtoi = exp_so3(lambda * log_so3(R_1 * R_0.transpose())) * R_0;
+      G_p_i = (1 - lambda) * gps_clones.at(0).first->pos() + lambda * gps_clones.at(1).first->pos();
+    }
+  }
 
-  // exp_G_p_Gps
-  exp_G_p_Gps = vio_to_gps_r * exp_G_p_Gps;
-  // exp_G_p_Gps = vio_to_gps_r * exp_G_p_Gps + vio_to_gps_t;
+  // Our GPS antenna lever arm, and the transform from our global frame into the ENU frame of the fixes
+  Eigen::Vector3d I_p_Gps = state->_calib_IMUtoGPS->value();
+  double yaw_GtoENU = state->_calib_GtoENU->value()(0);
+  Eigen::Vector3d ENU_p_G = state->_calib_GtoENU->value().block(1, 0, 3, 1);
+  Eigen::Matrix3d R_GtoENU;
+  R_GtoENU << std::cos(yaw_GtoENU), -std::sin(yaw_GtoENU), 0, std::sin(yaw_GtoENU), std::cos(yaw_GtoENU), 0, 0, 0, 1;
 
+  // Where we expect the antenna to be in our global frame, and in the ENU frame
+  Eigen::Vector3d G_p_Gps_in_vio = G_p_i + R_Gtoi.transpose() * I_p_Gps;
+  Eigen::Vector3d exp_G_p_Gps = R_GtoENU * G_p_Gps_in_vio + ENU_p_G;
 
-  if(true)
   {
-    vio_to_gps_path.header.frame_id = "global";
-    vio_to_gps_path.header.stamp = ros::Time::now();
-
     geometry_msgs::PoseStamped vio_to_gps_pose;
-    vio_to_gps_pose.header = vio_to_gps_path.header;
-
-
-    // vio_to_gps_pose.pose.position.x = exp_VIO_p_Gps[0];
-    // vio_to_gps_pose.pose.position.y = exp_VIO_p_Gps[1];
-    // vio_to_gps_pose.pose.position.z = exp_VIO_p_Gps[2];
+    vio_to_gps_pose.header = pose.header;
 
     vio_to_gps_pose.pose.position.x = exp_G_p_Gps[0];
     vio_to_gps_pose.pose.position.y = exp_G_p_Gps[1];
     vio_to_gps_pose.pose.position.z = exp_G_p_Gps[2];
 
-
     vio_to_gps_pose.pose.orientation.x = 0;
     vio_to_gps_pose.pose.orientation.y = 0;
     vio_to_gps_pose.pose.orientation.z = 0;
     vio_to_gps_pose.pose.orientation.w = 1;
 
-    vio_to_gps_path.poses.push_back(vio_to_gps_pose);
-
-    vio_to_gps_pub.publish(vio_to_gps_path);
+    if (vio_to_gps_path != nullptr)
+      vio_to_gps_path->append(vio_to_gps_pose);
   }
 
-  if(true)
   {
-    vio_path.header.frame_id = "global";
-    vio_path.header.stamp = ros::Time::now();
-
     geometry_msgs::PoseStamped vio_pose;
-    vio_pose.header = vio_path.header;
+    vio_pose.header = pose.header;
 
     vio_pose.pose.position.x = G_p_i[0];
     vio_pose.pose.position.y = G_p_i[1];
@@ -1135,52 +1344,101 @@ bool VioManager::update_state(const ov_core::GpsData message, std::shared_ptr<St
     vio_pose.pose.orientation.z = 0;
     vio_pose.pose.orientation.w = 1;
 
-    vio_path.poses.push_back(vio_pose);
-
-    vio_path_pub.publish(vio_path);
+    if (vio_path != nullptr)
+      vio_path->append(vio_pose);
   }
 
+  // Residual of the fix in the ENU frame
+  Eigen::VectorXd res = G_p_Gps - exp_G_p_Gps;
+
+  // The GPS position only depends on the IMU orientation and position (and our GPS calibration if we are estimating it)
+  // Thus we only pass these to our update so we do not need to construct a jacobian of the full state size
+  // If we are using clones, then each of their errors is weighted by how close it is to the fix time (first order in their rotation)
+  std::vector<std::shared_ptr<Type>> Hx_order;
+  int num_poses = gps_clones.empty() ? 1 : (int)gps_clones.size();
+  int size = 6 * num_poses;
+  size += (state->_options.do_calib_gps_leverarm) ? 3 : 0;
+  size += (state->_options.do_calib_gps_frame) ? 4 : 0;
+  Eigen::MatrixXd H = Eigen::MatrixXd::Zero(3, size);
+  Eigen::Matrix3d dpgps_dq = -R_GtoENU * R_Gtoi.transpose() * skew_x(I_p_Gps);
+  if (gps_clones.empty()) {
+    Hx_order.push_back(state->_imu->q());
+    Hx_order.push_back(state->_imu->p());
+    H.block<3, 3>(0, 0) = dpgps_dq;
+    H.block<3, 3>(0, 3) = R_GtoENU;
+  } else {
+    for (size_t i = 0; i < gps_clones.size(); i++) {
+      Hx_order.push_back(gps_clones.at(i).first->q());
+      Hx_order.push_back(gps_clones.at(i).first->p());
+      H.block<3, 3>(0, 6 * i) = gps_clones.at(i).second * dpgps_dq;
+      H.block<3, 3>(0, 6 * i + 3) = gps_clones.at(i).second * R_GtoENU;
+    }
+  }
+  int col = 6 * num_poses;
+  if (state->_options.do_calib_gps_leverarm) {
+    Hx_order.push_back(state->_calib_IMUtoGPS);
+    H.block<3, 3>(0, col) = R_GtoENU * R_Gtoi.transpose();
+    col += 3;
+  }
+  if (state->_options.do_calib_gps_frame) {
+    Hx_order.push_back(state->_calib_GtoENU);
+    H.block<3, 1>(0, col) = R_GtoENU * skew_x(Eigen::Vector3d::UnitZ()) * G_p_Gps_in_vio;
+    H.block<3, 3>(0, col + 1) = Eigen::Matrix3d::Identity();
+  }
 
-  // res = G_p_Gps - exp_G_p_Gps;
-
-  // res = G_p_i - exp_VIO_p_Gps;
-  res = exp_VIO_p_Gps - G_p_i;
-  // res[2] = 0;
-
-  // std::cout << res.transpose() << std::endl;
-
-  // std::cout << "res norm: " << res.norm() << std::endl;
-
-  H.block<3,3>(0,3) = Eigen::Matrix3d::Identity();
-
-  // H << -state->_imu->Rot() * skew_x(I_p_Gps), Eigen::Matrix3d::Identity();
-
-  const size_t state_size = state->max_covariance_size();
-  Eigen::MatrixXd Hx(3, state_size);
-  Hx.setZero();
-  Hx.block<3, 15>(0, state->_imu->id()) = H;
+  // Noise of the fix, which we do not let get overconfident
+  // If the receiver did not report it, then we use our default noise for these fixes
+  Eigen::MatrixXd R = message.cov;
+  if (!message.has_cov)
+    R = std::pow(params.gps_sigma_unknown, 2) * Eigen::MatrixXd::Identity(3, 3);
+  StateHelper::LimitMinDiagValue(std::pow(params.gps_sigma_min, 2), &R);
+
+  // Chi2 distance check, so we can cheaply reject fixes that do not agree with our state (e.g. multipath)
+  Eigen::MatrixXd P_marg = StateHelper::get_marginal_covariance(state, Hx_order);
+  Eigen::MatrixXd S = H * P_marg * H.transpose() + R;
+  double chi2 = res.dot(S.llt().solve(res));
+  double chi2_check = chi_squared_table_gps->quantile((int)res.rows());
+  if (chi2 > params.gps_options.chi2_multipler * chi2_check) {
+    printf(YELLOW "[GPS]: rejected fix at %.3f (chi2 = %.3f > %.3f)\n" RESET, message.timestamp, chi2,
+           params.gps_options.chi2_multipler * chi2_check);
+    return false;
+  }
 
-  // std::cout << state->_imu->id() << std::endl;
-  // std::cout << state->_imu->size() << std::endl;
+  StateHelper::EKFUpdate(state, Hx_order, H, res, R);
+  return true;
+}
 
-  Eigen::Matrix3d cov = message.cov;
-  cov(2, 2) = 1e-6;
+bool VioManager::get_gps_clones(double timestamp, std::vector<std::pair<std::shared_ptr<PoseJPL>, double>> &clones) {
 
-  // if(res.norm() > 5)
-  // {
-  //   return true;
-  // }
+  // Return if we do not have any clones
+  clones.clear();
+  if (state->_clones_IMU.empty())
+    return false;
 
+  // Find the clones right before and after this time
+  auto it_after = state->_clones_IMU.lower_bound(timestamp);
+  auto it_before = (it_after == state->_clones_IMU.begin()) ? state->_clones_IMU.end() : std::prev(it_after);
 
-  StateHelper::EKFUpdate(state, Hx, res, cov);
+  // Use the closest clone directly if it is close enough to the fix
+  double dt_before = (it_before != state->_clones_IMU.end()) ? timestamp - it_before->first : INFINITY;
+  double dt_after = (it_after != state->_clones_IMU.end()) ? it_after->first - timestamp : INFINITY;
+  if (std::min(dt_before, dt_after) <= params.gps_clone_max_dt) {
+    clones.push_back({(dt_before < dt_after) ? it_before->second : it_after->second, 1.0});
+    return true;
+  }
 
-  
+  // Else we need a clone on both sides to interpolate between
+  if (it_before == state->_clones_IMU.end() || it_after == state->_clones_IMU.end())
+    return false;
+  double lambda = dt_before / (it_after->first - it_before->first);
+  clones.push_back({it_before->second, 1.0 - lambda});
+  clones.push_back({it_after->second, lambda});
   return true;
 }
 
-void VioManager::publish_odometry(double timestamp, ros::Publisher& publisher) {
-  // Only publish if VIO is initialized
-  if (!is_initialized_vio)
+void VioManager::publish_odometry(double timestamp, ros::Publisher& publisher, bool propagate) {
+  // Only publish if VIO is initialized, and we have advertised our publishers
+  if (!is_initialized_vio || !publisher)
     return;
 
   // Create odometry message
@@ -1191,11 +1449,22 @@ void VioManager::publish_odometry(double timestamp, ros::Publisher& publisher) {
   odom_msg.header.frame_id = "global";  // or "odom" depending on your coordinate frame
   odom_msg.child_frame_id = "base_link";  // or "imu_link" depending on your setup
 
-  // Get current IMU state
-  Eigen::Vector3d pos = state->_imu->pos();
-  Eigen::Vector4d quat = state->_imu->quat();  // JPL quaternion [qx, qy, qz, qw]
-  Eigen::Vector3d vel = state->_imu->vel();
-  Eigen::Vector3d gyro_bias = state->_imu->bias_g();
+  // Get current IMU state (q_GtoI, p_IinG, v_IinG, w_IinI)
+  // If requested we will propagate it forward to the given IMU time, so we move between camera updates
+  // NOTE: this does not change our state, it only integrates a copy of the IMU state forward
+  Eigen::Matrix<double, 13, 1> state_plus = Eigen::Matrix<double, 13, 1>::Zero();
+  double timestamp_inC = timestamp - state->_calib_dt_CAMtoIMU->value()(0);
+  if (propagate && timestamp_inC > state->_timestamp) {
+    propagator->fast_state_propagate(state, timestamp_inC, state_plus);
+  } else {
+    state_plus.block(0, 0, 4, 1) = state->_imu->quat();
+    state_plus.block(4, 0, 3, 1) = state->_imu->pos();
+    state_plus.block(7, 0, 3, 1) = state->_imu->vel();
+  }
+  Eigen::Vector3d pos = state_plus.block(4, 0, 3, 1);
+  Eigen::Vector4d quat = state_plus.block(0, 0, 4, 1);  // JPL quaternion [qx, qy, qz, qw]
+  Eigen::Vector3d vel = state_plus.block(7, 0, 3, 1);
+  Eigen::Vector3d omega = state_plus.block(10, 0, 3, 1);
 
   // Set position (IMU position in global frame)
   odom_msg.pose.pose.position.x = pos(0);
@@ -1214,53 +1483,31 @@ void VioManager::publish_odometry(double timestamp, ros::Publisher& publisher) {
   odom_msg.twist.twist.linear.y = vel(1);
   odom_msg.twist.twist.linear.z = vel(2);
 
-  // Angular velocity: Get the latest IMU measurement if available
-  // For now, set to zero - could be improved by accessing latest gyro measurement
-  odom_msg.twist.twist.angular.x = 0.0;
-  odom_msg.twist.twist.angular.y = 0.0;
-  odom_msg.twist.twist.angular.z = 0.0;
+  // Angular velocity is the bias corrected gyroscope reading (only available if we propagated)
+  odom_msg.twist.twist.angular.x = omega(0);
+  odom_msg.twist.twist.angular.y = omega(1);
+  odom_msg.twist.twist.angular.z = omega(2);
 
-  // Set covariance matrices from state covariance if available
+  // Set covariance matrices from state covariance
   // Initialize to zero
   for (int i = 0; i < 36; i++) {
     odom_msg.pose.covariance[i] = 0.0;
     odom_msg.twist.covariance[i] = 0.0;
   }
-  
-  // Extract covariance from state if available
-  Eigen::MatrixXd full_cov = StateHelper::get_full_covariance(state);
-  if (full_cov.rows() >= 15 && full_cov.cols() >= 15) {
-    // Position covariance (extract 3x3 block for position)
-    for (int i = 0; i < 3; i++) {
-      for (int j = 0; j < 3; j++) {
-        odom_msg.pose.covariance[i * 6 + j] = full_cov(4 + i, 4 + j);  // Position starts at index 4 in state
-      }
-    }
-    
-    // Orientation covariance (extract 3x3 block for orientation)
-    for (int i = 0; i < 3; i++) {
-      for (int j = 0; j < 3; j++) {
-        odom_msg.pose.covariance[(3 + i) * 6 + (3 + j)] = full_cov(0 + i, 0 + j);  // Orientation starts at index 0
-      }
-    }
-    
-    // Velocity covariance (extract 3x3 block for velocity)
-    for (int i = 0; i < 3; i++) {
-      for (int j = 0; j < 3; j++) {
-        odom_msg.twist.covariance[i * 6 + j] = full_cov(7 + i, 7 + j);  // Velocity starts at index 7
-      }
+
+  // We only need the marginal of the orientation, position and velocity so do not copy the full covariance
+  // NOTE: this is the covariance at the last update time, it is not propagated forward
+  std::vector<std::shared_ptr<Type>> statevars;
+  statevars.push_back(state->_imu->q());
+  statevars.push_back(state->_imu->p());
+  statevars.push_back(state->_imu->v());
+  Eigen::Matrix<double, 9, 9> cov = StateHelper::get_marginal_covariance(state, statevars);
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 3; j++) {
+      odom_msg.pose.covariance[i * 6 + j] = cov(3 + i, 3 + j);             // position
+      odom_msg.pose.covariance[(3 + i) * 6 + (3 + j)] = cov(0 + i, 0 + j); // orientation
+      odom_msg.twist.covariance[i * 6 + j] = cov(6 + i, 6 + j);            // velocity
     }
-  } else {
-    // Fallback to reasonable default values
-    odom_msg.pose.covariance[0] = 0.1;   // x
-    odom_msg.pose.covariance[7] = 0.1;   // y  
-    odom_msg.pose.covariance[14] = 0.1;  // z
-    odom_msg.pose.covariance[21] = 0.1;  // roll
-    odom_msg.pose.covariance[28] = 0.1;  // pitch
-    odom_msg.pose.covariance[35] = 0.1;  // yaw
-    odom_msg.twist.covariance[0] = 0.1;  // vx
-    odom_msg.twist.covariance[7] = 0.1;  // vy
-    odom_msg.twist.covariance[14] = 0.1; // vz
   }
 
   // Publish the odometry message using the provided publisher
@@ -24,10 +24,15 @@
 
 #include <Eigen/StdVector>
 #include <algorithm>
+#include <atomic>
 #include <boost/filesystem.hpp>
+#include <condition_variable>
+#include <deque>
 #include <fstream>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <ros/ros.h>
 
 #include "cam/CamBase.h"
@@ -40,8 +45,11 @@
 #include "track/TrackSIM.h"
 #include "types/Landmark.h"
 #include "types/LandmarkRepresentation.h"
+#include "utils/async_logger.h"
+#include "utils/chi_squared_table.h"
 #include "utils/lambda_body.h"
 #include "utils/sensor_data.h"
+#include "utils/sensor_queue.h"
 
 #include "state/Propagator.h"
 #include "state/State.h"
@@ -50,6 +58,8 @@
 #include "update/UpdaterSLAM.h"
 #include "update/UpdaterZeroVelocity.h"
 
+#include "GpsFrontend.h"
+#include "PathPublisher.h"
 #include "VioManagerOptions.h"
 #include <nav_msgs/Path.h>
 #include <nav_msgs/Odometry.h>
@@ -69,10 +79,18 @@ class VioManager {
 public:
   /**
    * @brief Default constructor, will load all configuration variables
+   *
+   * Our paths and odometry are only published if ros::init() has been called and the ROS master is running.
+   *
    * @param params_ Parameters loaded from either ROS or CMDLINE
    */
   VioManager(VioManagerOptions &params_);
 
+  /**
+   * @brief Destructor, will stop our asynchronous tracking thread if it is running
+   */
+  ~VioManager();
+
   /**
    * @brief Feed function for inertial data
    * @param message Contains our timestamp and inertial information
@@ -82,17 +100,19 @@ public:
   /**
    * @brief Feed function for camera measurements
    * @param message Contains our timestamp, images, and camera ids
+   *
+   * This only queues the message, which is processed once we have IMU readings past it.
+   * Thus this can be called from a different thread then feed_measurement_imu() (e.g. by a multi-threaded ROS spinner).
    */
-  void feed_measurement_camera(const ov_core::CameraData &message) {
-    camera_queue.push_back(message);
-    std::sort(camera_queue.begin(), camera_queue.end());
-  }
+  void feed_measurement_camera(const ov_core::CameraData &message) { camera_queue.push(message); }
 
-  void feed_measurement_gps(const ov_core::GpsData &message)
-  {
-    gps_queue.push_back(message);
-    std::sort(gps_queue.begin(), gps_queue.end());
-  }
+  /**
+   * @brief Feed function for GPS measurements
+   * @param message Contains our timestamp, position, and covariance
+   *
+   * Like feed_measurement_camera() this only queues the message, so it can be called from a different thread.
+   */
+  void feed_measurement_gps(const ov_core::GpsData &message) { gps_queue.push(message); }
 
   /**
    * @brief Feed function for a synchronized simulated cameras
@@ -120,9 +140,9 @@ public:
     StateHelper::fix_4dof_gauge_freedoms(state, imustate.block(1, 0, 4, 1));
 
     // Cleanup any features older then the initialization time
-    trackFEATS->get_feature_database()->cleanup_measurements(state->_timestamp);
-    if (trackARUCO != nullptr) {
-      trackARUCO->get_feature_database()->cleanup_measurements(state->_timestamp);
+    databaseFEATS->cleanup_measurements(state->_timestamp);
+    if (databaseARUCO != nullptr) {
+      databaseARUCO->cleanup_measurements(state->_timestamp);
     }
 
     // Print what we init'ed with
@@ -244,19 +264,40 @@ public:
     feat_tracks_uvd = active_tracks_uvd;
   }
 
-  Eigen::Vector3d ConvertLonLatHeiToENU(const Eigen::Vector3d &init_long_lat_hei, const Eigen::Vector3d &point_long_lat_hei);
+  /// Get our GPS frontend, which converts fixes into our ENU frame
+  std::shared_ptr<GpsFrontend> get_gps_frontend() { return gps_frontend; }
 
 public:
-  ros::Publisher gps_path_pub;
-  ros::Publisher vio_path_pub;
-  ros::Publisher vio_to_gps_pub;
+  /// Odometry publishers at the camera and IMU rate (invalid if we are not publishing to ROS)
   ros::Publisher odom_vio_cam_rate_pub;
   ros::Publisher odom_vio_imu_rate_pub;
 
-  std::ofstream file_state;
-  std::ofstream file_gps;
+  /// Logs of our state and the GPS fix (in ENU) at each fix, null if we are not logging them
+  std::shared_ptr<ov_core::AsyncLogger> log_state;
+  std::shared_ptr<ov_core::AsyncLogger> log_gps;
 
 protected:
+  /**
+   * @brief Output of our asynchronous feature tracking thread for a single camera message.
+   *
+   * This only contains the new measurements our trackers have extracted at this timestep.
+   * The estimator thread will append these into its own feature databases before doing its update.
+   */
+  struct TrackedFrame {
+
+    /// Camera message (after downsampling) that was tracked
+    ov_core::CameraData message;
+
+    /// New measurements from our sparse feature tracker at this timestep
+    std::vector<FeatureDatabase::Measurement> feats;
+
+    /// New measurements from our aruco tracker at this timestep (empty if not using aruco)
+    std::vector<FeatureDatabase::Measurement> aruco;
+
+    /// Time it took to perform the tracking (seconds)
+    double time_track = 0.0;
+  };
+
   /**
    * @brief Given a new set of camera images, this will track them.
    *
@@ -267,17 +308,89 @@ protected:
    */
   void track_image_and_update(const ov_core::CameraData &message);
 
+  /**
+   * @brief Feature tracking front-end, will feed the images into our visual trackers.
+   * @param message Contains our timestamp, images, and camera ids
+   * @return Camera message after any downsampling which was tracked
+   */
+  ov_core::CameraData track_image(const ov_core::CameraData &message);
+
+  /**
+   * @brief Estimator back-end, this will try zero velocity update, initialization and then the propagate and update.
+   * @param message Contains our timestamp, images, and camera ids (the new measurements should already be in our databases)
+   */
+  void update_with_tracked_image(const ov_core::CameraData &message);
+
+  /**
+   * @brief Main loop of our asynchronous feature tracking thread.
+   *
+   * This will track all camera messages passed in the input queue and then append the new measurements to our output queue.
+   * If the estimator falls behind we will either wait for it or drop the oldest tracked frame (see async_tracking_policy).
+   */
+  void run_async_tracking();
+
+  /**
+   * @brief Passes a camera message to our asynchronous tracking thread.
+   *
+   * If the tracker has fallen behind (its input queue is full) we will either wait for it or drop the oldest untracked image.
+   * @param message Camera message we should track
+   */
+  void push_async_tracking(const ov_core::CameraData &message);
+
+  /// Updates our state with all frames our asynchronous tracking thread has finished
+  void process_async_tracked_frames();
+
+  /**
+   * @brief Will append the new measurements of an asynchronously tracked frame and update the state with it
+   * @param frame Tracked frame from our tracking thread
+   */
+  void process_tracked_frame(const std::shared_ptr<TrackedFrame> &frame);
+
   void track_gps_and_update(const ov_core::GpsData &message);
 
+  /**
+   * @brief Predicts the rotation of each camera since its last image using the gyroscope.
+   *
+   * This is passed with the images to our tracker, which uses it to predict where its features will be.
+   * If we can not predict the rotation of all cameras (e.g. this is the first image) the message is left without any.
+   *
+   * @param message Camera message we will track next
+   */
+  void predict_camera_rotations(ov_core::CameraData &message);
 
+  /**
+   * @brief Updates our state with a GPS fix.
+   *
+   * The fix is converted into our ENU frame and compared against the GPS antenna position we expect in it, which depends
+   * on the IMU pose, the antenna lever arm, and the yaw and position of our global frame in the ENU frame (the last two are optionally estimated).
+   * The fix is only used if it passes a chi2 test, so outliers (e.g. multipath) are rejected before they corrupt our state.
+   *
+   * @param message GPS fix we should update with
+   * @param state Our state
+   * @return False if the fix was not used
+   */
   bool update_state(const ov_core::GpsData message, std::shared_ptr<State> state);
 
+  /**
+   * @brief Gets the clones we should use to fuse a GPS fix at its own time.
+   *
+   * If a clone is within gps_clone_max_dt of the fix we use just that clone.
+   * Otherwise we interpolate between the clones before and after the fix, and return each with its interpolation weight.
+   * This allows fixes which arrive with some latency to still be fused against the pose at their time.
+   *
+   * @param timestamp Time of the GPS fix
+   * @param clones Clones with their weight (summing to one)
+   * @return False if the fix is not within our window of clones
+   */
+  bool get_gps_clones(double timestamp, std::vector<std::pair<std::shared_ptr<ov_type::PoseJPL>, double>> &clones);
+
   /**
    * @brief Publish VIO odometry message
    * @param timestamp Current timestamp
    * @param publisher ROS publisher to use for publishing
+   * @param propagate If we should propagate the pose forward to this (IMU clock) timestamp using our IMU readings
    */
-  void publish_odometry(double timestamp, ros::Publisher& publisher);
+  void publish_odometry(double timestamp, ros::Publisher& publisher, bool propagate);
 
   /**
    * @brief This will do the propagation and feature updates to the state
@@ -325,6 +438,12 @@ protected:
   /// Our aruoc tracker
   std::shared_ptr<TrackBase> trackARUCO;
 
+  /// Feature database our estimator uses for sparse features (the tracker's own database unless tracking asynchronously)
+  std::shared_ptr<FeatureDatabase> databaseFEATS;
+
+  /// Feature database our estimator uses for aruco tags (the tracker's own database unless tracking asynchronously)
+  std::shared_ptr<FeatureDatabase> databaseARUCO;
+
   /// State initializer
   std::shared_ptr<InertialInitializer> initializer;
 
@@ -345,21 +464,46 @@ protected:
   /// exactly one IMU measurement with timestamp newer than the camera measurement
   /// This also handles out-of-order camera measurements, which is rare, but
   /// a nice feature to have for general robustness to bad camera drivers.
-  std::deque<ov_core::CameraData> camera_queue;
+  ov_core::SensorQueue<ov_core::CameraData> camera_queue;
+
+  /// Queue up GPS measurements sorted by time, processed like the camera measurements
+  ov_core::SensorQueue<ov_core::GpsData> gps_queue;
+
+  /// Timestamp of the last image we tracked of each camera
+  std::map<int, double> camera_last_timestamp;
+
+  /// Asynchronous tracking thread, and if it should keep running
+  std::thread async_thread;
+  bool async_running = false;
 
-  std::deque<ov_core::GpsData> gps_queue;
+  /// Lock and conditions protecting our asynchronous tracking queues (the tracker waits on the first two, the estimator on the last)
+  std::mutex async_mtx;
+  std::condition_variable async_cv_input, async_cv_output, async_cv_estimator;
 
+  /// Camera messages waiting to be tracked, and tracked frames waiting for the estimator
+  std::deque<ov_core::CameraData> async_queue_input;
+  std::deque<std::shared_ptr<TrackedFrame>> async_queue_output;
+
+  /// Measurements older than this time can be removed from the tracker databases by the tracking thread
+  std::atomic<double> async_cleanup_time{-1};
+
+  /// Last GPS fix before we initialized (origin of our ENU frame), timestamp is negative if we have not had one
   ov_core::GpsData latest_gps_data;
 
-  Eigen::Vector3d I_p_Gps;
+  /// Converts GPS fixes into our ENU frame
+  std::shared_ptr<GpsFrontend> gps_frontend;
+
+  /// Chi-squared quantiles we gate our GPS fixes with
+  std::shared_ptr<ov_core::ChiSquaredTable> chi_squared_table_gps;
 
-  nav_msgs::Path gps_path;
-  nav_msgs::Path vio_path;
-  nav_msgs::Path vio_to_gps_path;
+  /// Paths of the GPS fixes, our estimate at each fix, and our estimate of the GPS antenna at each fix (null if we are not publishing to ROS)
+  std::shared_ptr<PathPublisher> gps_path;
+  std::shared_ptr<PathPublisher> vio_path;
+  std::shared_ptr<PathPublisher> vio_to_gps_path;
   
 
   // Timing statistic file and variables
-  std::ofstream of_statistics;
+  std::shared_ptr<ov_core::AsyncLogger> of_statistics;
   boost::posix_time::ptime rT1, rT2, rT3, rT4, rT5, rT6, rT7;
 
   // Track how much distance we have traveled
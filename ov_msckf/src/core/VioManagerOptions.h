@@ -23,6 +23,7 @@
 #define OV_MSCKF_VIOMANAGEROPTIONS_H
 
 #include <Eigen/Eigen>
+#include <cstdlib>
 #include <iostream>
 #include <string>
 #include <vector>
@@ -78,12 +79,42 @@ struct VioManagerOptions {
   /// If we should only use the zupt at the very beginning static initialization phase
   bool zupt_only_at_beginning = false;
 
+  /// If GPS fixes should be fused at their own time using our clones, instead of against the current IMU state
+  bool gps_use_clones = false;
+
+  /// Max time (seconds) between a GPS fix and a clone to directly use that clone, otherwise we interpolate between the two around it
+  double gps_clone_max_dt = 0.01;
+
+  /// Min noise sigma (meters) of each axis of a GPS fix, fixes which report less are inflated to this
+  double gps_sigma_min = 1.0;
+
+  /// Noise sigma (meters) of each axis of a GPS fix whose receiver did not report its covariance
+  double gps_sigma_unknown = 10.0;
+
   /// If we should record the timing performance to file
   bool record_timing_information = false;
 
   /// The path to the file we will record the timing information into
   std::string record_timing_filepath = "ov_msckf_timing.txt";
 
+  /// Directory we will log the GPS fixes and our state at each fix into (empty to not log them)
+  std::string log_directory = "";
+
+  /// Size (MB) our log files (and timing file) can grow to before we start a new one (zero to never rotate)
+  int log_max_file_mb = 0;
+
+  /// Max number of files we keep of each log (zero to keep all)
+  int log_max_files = 0;
+
+  /// Max number of poses in each published path (every other pose is dropped once we have more)
+  int path_max_length = 16384;
+
+  /// Min distance (meters) between the poses of our published paths
+  double path_min_distance = 0.0;
+
+  /// Min time (seconds) between the poses of our published paths
+  double path_min_dt = 0.0;
+
   /**
    * @brief This function will print out all estimator settings loaded.
    * This allows for visual checking that everything was loaded properly from ROS/CMD parsers.
@@ -99,8 +130,18 @@ struct VioManagerOptions {
     printf("\t- zupt_noise_multiplier: %.2f\n", zupt_noise_multiplier);
     printf("\t- zupt_max_disparity: %.4f\n", zupt_max_disparity);
     printf("\t- zupt_only_at_beginning?: %d\n", zupt_only_at_beginning);
+    printf("\t- gps_use_clones?: %d\n", gps_use_clones);
+    printf("\t- gps_clone_max_dt: %.3f\n", gps_clone_max_dt);
+    printf("\t- gps_sigma_min: %.3f\n", gps_sigma_min);
+    printf("\t- gps_sigma_unknown: %.3f\n", gps_sigma_unknown);
     printf("\t- record timing?: %d\n", (int)record_timing_information);
     printf("\t- record timing filepath: %s\n", record_timing_filepath.c_str());
+    printf("\t- log directory: %s\n", log_directory.c_str());
+    printf("\t- log max file size (MB): %d\n", log_max_file_mb);
+    printf("\t- log max files: %d\n", log_max_files);
+    printf("\t- path max length: %d\n", path_max_length);
+    printf("\t- path min distance: %.3f\n", path_min_distance);
+    printf("\t- path min dt: %.3f\n", path_min_dt);
   }
 
   // NOISE / CHI2 ============================
@@ -120,6 +161,9 @@ struct VioManagerOptions {
   /// Update options for zero velocity (chi2 multiplier)
   UpdaterOptions zupt_options;
 
+  /// Update options for GPS fixes (chi2 multiplier)
+  UpdaterOptions gps_options;
+
   /**
    * @brief This function will print out all noise parameters loaded.
    * This allows for visual checking that everything was loaded properly from ROS/CMD parsers.
@@ -135,6 +179,8 @@ struct VioManagerOptions {
     aruco_options.print();
     printf("\tUpdater ZUPT:\n");
     zupt_options.print();
+    printf("\tUpdater GPS:\n");
+    gps_options.print();
   }
 
   // STATE DEFAULTS ==========================
@@ -145,6 +191,12 @@ struct VioManagerOptions {
   /// Time offset between camera and IMU.
   double calib_camimu_dt = 0.0;
 
+  /// Position of the GPS antenna in the IMU frame (p_GPSinI)
+  Eigen::Vector3d gps_leverarm = Eigen::Vector3d::Zero();
+
+  /// Yaw (radians) of our global frame in the ENU frame of the GPS
+  double gps_yaw_GtoENU = 0.0;
+
   /// Map between camid and camera model (true=fisheye, false=radtan)
   std::map<size_t, bool> camera_fisheye;
 
@@ -166,6 +218,8 @@ struct VioManagerOptions {
     printf("\t- gravity_mag: %.4f\n", gravity_mag);
     printf("\t- gravity: %.3f, %.3f, %.3f\n", 0.0, 0.0, gravity_mag);
     printf("\t- calib_camimu_dt: %.4f\n", calib_camimu_dt);
+    printf("\t- gps_leverarm: %.3f, %.3f, %.3f\n", gps_leverarm(0), gps_leverarm(1), gps_leverarm(2));
+    printf("\t- gps_yaw_GtoENU: %.4f\n", gps_yaw_GtoENU);
     assert(state_options.num_cameras == (int)camera_fisheye.size());
     for (int n = 0; n < state_options.num_cameras; n++) {
       std::cout << "cam_" << n << "_fisheye:" << camera_fisheye.at(n) << std::endl;
@@ -201,6 +255,51 @@ struct VioManagerOptions {
   /// If our front-end should try to use some multi-threading for stereo matching
   bool use_multi_threading = true;
 
+  /// If we should undistort tracked features through a precomputed lookup table of each camera (not used with online intrinsic calibration)
+  bool use_undistort_table = false;
+
+  /// If KLT should predict where features will be in each new image using the gyroscope rotation since the last image
+  bool use_klt_prediction = false;
+
+  /// Number of pyramid levels KLT tracks with if we have predicted the features
+  int klt_pred_pyr_levels = 2;
+
+  /// Max number of KLT iterations on each pyramid level if we have predicted the features
+  int klt_pred_max_iters = 10;
+
+  /// What we should do if the estimator falls behind our asynchronous feature tracking thread
+  enum AsyncTrackingPolicy { BLOCK, DROP_OLDEST };
+
+  /// If we should run feature tracking in its own thread, pipelined with the estimator update (not allowed with online intrinsic calibration)
+  bool use_async_tracking = false;
+
+  /// Max number of images waiting to be tracked, and of tracked frames waiting for the estimator, when using asynchronous tracking
+  int async_tracking_queue_size = 2;
+
+  /// If we should block (backpressure) or drop the oldest image / tracked frame when one of the queues is full
+  AsyncTrackingPolicy async_tracking_policy = AsyncTrackingPolicy::BLOCK;
+
+  /**
+   * @brief Loads our asynchronous tracking policy from its name, will exit if it or our queue size are invalid
+   * @param policy Name of the policy (BLOCK or DROP_OLDEST)
+   */
+  void load_async_tracking_policy(const std::string &policy) {
+    if (policy == "BLOCK") {
+      async_tracking_policy = BLOCK;
+    } else if (policy == "DROP_OLDEST") {
+      async_tracking_policy = DROP_OLDEST;
+    } else {
+      printf(RED "VioManager(): invalid async tracking policy specified:\n" RESET);
+      printf(RED "\t- BLOCK\n" RESET);
+      printf(RED "\t- DROP_OLDEST\n" RESET);
+      std::exit(EXIT_FAILURE);
+    }
+    if (async_tracking_queue_size < 1) {
+      printf(RED "VioManager(): async tracking queue size needs to be greater than zero\n" RESET);
+      std::exit(EXIT_FAILURE);
+    }
+  }
+
   /// The number of points we should extract and track in *each* image frame. This highly effects the computation required for tracking.
   int num_pts = 150;
 
@@ -242,6 +341,13 @@ struct VioManagerOptions {
     printf("\t- downsize aruco: %d\n", downsize_aruco);
     printf("\t- downsize cameras: %d\n", downsample_cameras);
     printf("\t- use multi-threading: %d\n", use_multi_threading);
+    printf("\t- use undistort table: %d\n", use_undistort_table);
+    printf("\t- use klt prediction: %d\n", use_klt_prediction);
+    printf("\t- klt prediction pyramid levels: %d\n", klt_pred_pyr_levels);
+    printf("\t- klt prediction max iterations: %d\n", klt_pred_max_iters);
+    printf("\t- use async tracking: %d\n", use_async_tracking);
+    printf("\t- async tracking queue size: %d\n", async_tracking_queue_size);
+    printf("\t- async tracking policy: %d\n", (int)async_tracking_policy);
     printf("\t- num_pts: %d\n", num_pts);
     printf("\t- fast threshold: %d\n", fast_threshold);
     printf("\t- grid X by Y: %d by %d\n", grid_x, grid_y);
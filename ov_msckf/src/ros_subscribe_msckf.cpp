@@ -124,10 +124,15 @@ int main(int argc, char **argv) {
   //===================================================================================
 
   // Spin off to ROS
-  // TODO: maybe should use multi-thread spinner
-  // TODO: but need to support multi-threaded calls to viomanager
-  ROS_INFO("done...spinning to ros");
-  ros::spin();
+  // NOTE: the camera and gps callbacks only queue their measurements, so they can run in parallel to the imu callback
+  // NOTE: ros does not call the same callback in parallel, thus the imu callback (which runs our estimator) is still serial
+  int num_spinner_threads = 4;
+  nh.param<int>("num_spinner_threads", num_spinner_threads, num_spinner_threads);
+  ROS_INFO("done...spinning to ros (%d threads)", num_spinner_threads);
+  ros::AsyncSpinner spinner(num_spinner_threads);
+  spinner.start();
+  ros::waitForShutdown();
+  spinner.stop();
 
   // Final visualization
   viz->visualize_final();
@@ -237,6 +242,9 @@ void callback_gps(const sensor_msgs::NavSatFix::ConstPtr &msg)
                  msg->position_covariance[3], msg->position_covariance[4], msg->position_covariance[5],
                  msg->position_covariance[6], msg->position_covariance[7], msg->position_covariance[8];
 
+  // Receivers which do not know their covariance report zeros, so the estimator uses its own default noise instead
+  message.has_cov = (msg->position_covariance_type != sensor_msgs::NavSatFix::COVARIANCE_TYPE_UNKNOWN);
+
   // send it to our VIO system
   sys->feed_measurement_gps(message);
 }
\ No newline at end of file
@@ -0,0 +1,279 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2021 Patrick Geneva
+ * Copyright (C) 2021 Guoquan Huang
+ * Copyright (C) 2021 OpenVINS Contributors
+ * Copyright (C) 2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <csignal>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/filesystem.hpp>
+
+#include "core/StateRecorder.h"
+#include "core/VioManager.h"
+#include "sim/Simulator.h"
+#include "utils/CLI11.hpp"
+#include "utils/colors.h"
+#include "utils/parse_cmd.h"
+
+using namespace ov_msckf;
+
+/// A single simulation run of our batch
+struct SimRun {
+
+  /// Id of this run
+  size_t id = 0;
+
+  /// Options of this run (with its own seed)
+  VioManagerOptions params;
+
+  /// Directory the estimate, deviation, groundtruth, and timing files of this run are saved in
+  std::string directory;
+};
+
+// Define the function to be called when ctrl-c (SIGINT) is sent to process
+void signal_callback_handler(int signum) { std::exit(signum); }
+
+/**
+ * @brief Splits command line arguments into options and their values (e.g. "--max_clones 11" or "--max_clones=11")
+ * @param args Arguments (without the program name)
+ * @return Each option name along with all its arguments
+ */
+std::vector<std::pair<std::string, std::vector<std::string>>> group_arguments(const std::vector<std::string> &args) {
+  std::vector<std::pair<std::string, std::vector<std::string>>> groups;
+  for (const std::string &arg : args) {
+    if (arg.rfind("--", 0) == 0 || groups.empty()) {
+      groups.push_back({arg.substr(0, arg.find('=')), {arg}});
+    } else {
+      groups.back().second.push_back(arg);
+    }
+  }
+  return groups;
+}
+
+/**
+ * @brief Overrides the base command line arguments with those of a single run
+ *
+ * Our command line parser does not allow an option to be given twice, so any option the run sets is removed from the base arguments.
+ *
+ * @param base Arguments given to all runs (without the program name)
+ * @param overrides Arguments of this run
+ * @return Merged arguments (without the program name)
+ */
+std::vector<std::string> merge_arguments(const std::vector<std::string> &base, const std::vector<std::string> &overrides) {
+  auto groups_base = group_arguments(base);
+  auto groups_overrides = group_arguments(overrides);
+  std::vector<std::string> merged;
+  for (const auto &group : groups_base) {
+    bool overridden = std::any_of(groups_overrides.begin(), groups_overrides.end(),
+                                  [&](const std::pair<std::string, std::vector<std::string>> &o) { return o.first == group.first; });
+    if (!overridden)
+      merged.insert(merged.end(), group.second.begin(), group.second.end());
+  }
+  merged.insert(merged.end(), overrides.begin(), overrides.end());
+  return merged;
+}
+
+/**
+ * @brief Runs a single simulation from start to end, saving our state at each image
+ * @param run Simulation we should run
+ * @return False if we could not initialize
+ */
+bool run_simulation(const SimRun &run) {
+
+  // Create our VIO system and simulator, each with their own random generators
+  // NOTE: both constructors take a non-const reference, so give them our own copy of the options
+  VioManagerOptions params = run.params;
+  auto sim = std::make_shared<Simulator>(params);
+  auto sys = std::make_shared<VioManager>(params);
+
+  // Get initial state
+  Eigen::Matrix<double, 17, 1> imustate;
+  if (!sim->get_state(sim->current_timestamp(), imustate)) {
+    printf(RED "[SIM %zu]: Could not initialize the filter to the first state\n" RESET, run.id);
+    return false;
+  }
+
+  // Since the state time is in the camera frame of reference
+  // Subtract out the imu to camera time offset
+  imustate(0, 0) -= sim->get_true_paramters().calib_camimu_dt;
+
+  // Initialize our filter with the groundtruth
+  sys->initialize_with_gt(imustate);
+
+  // Files we save our estimate, its deviation, and the groundtruth into (in the format ov_eval error_simulation reads)
+  StateRecorder recorder(run.directory + "/state_estimate.txt", run.directory + "/state_deviation.txt",
+                         run.directory + "/state_groundtruth.txt", sim);
+  double last_saved_timestamp = -1;
+
+  // Buffer our camera image
+  double buffer_timecam = -1;
+  std::vector<int> buffer_camids;
+  std::vector<std::vector<std::pair<size_t, Eigen::VectorXf>>> buffer_feats;
+
+  // Step through the simulation
+  while (sim->ok()) {
+
+    // IMU: get the next simulated IMU measurement if we have it
+    ov_core::ImuData message_imu;
+    bool hasimu = sim->get_next_imu(message_imu.timestamp, message_imu.wm, message_imu.am);
+    if (hasimu) {
+      sys->feed_measurement_imu(message_imu);
+    }
+
+    // CAM: get the next simulated camera uv measurements if we have them
+    double time_cam;
+    std::vector<int> camids;
+    std::vector<std::vector<std::pair<size_t, Eigen::VectorXf>>> feats;
+    bool hascam = sim->get_next_cam(time_cam, camids, feats);
+    if (hascam) {
+      if (buffer_timecam != -1) {
+        sys->feed_measurement_simulation(buffer_timecam, buffer_camids, buffer_feats);
+        if (sys->initialized() && sys->get_state()->_timestamp != last_saved_timestamp) {
+          recorder.save(sys->get_state());
+          last_saved_timestamp = sys->get_state()->_timestamp;
+        }
+      }
+      buffer_timecam = time_cam;
+      buffer_camids = camids;
+      buffer_feats = feats;
+    }
+  }
+  return true;
+}
+
+// Main function
+int main(int argc, char **argv) {
+
+  // NOTE: we do not call ros::init(), so our VIO systems will not wait for a ROS master or publish anything
+  signal(SIGINT, signal_callback_handler);
+
+  // Options of our batch, all other options are passed to every run
+  CLI::App app{"run_simulation_batch"};
+  app.allow_extras();
+  int num_runs = 10;
+  int num_threads = std::max(1, (int)std::thread::hardware_concurrency());
+  std::string output_dir = "sim_runs";
+  std::string runs_file;
+  app.add_option("--num_runs", num_runs, "Number of runs if no runs file is given, each with the next measurement seed");
+  app.add_option("--num_threads", num_threads, "Number of runs we simulate at the same time");
+  app.add_option("--output_dir", output_dir, "Directory each run saves its files into (in its own run_<id> directory)");
+  app.add_option("--runs_file", runs_file, "File with the option overrides of each run, one run per line");
+  try {
+    app.parse(argc, argv);
+  } catch (const CLI::ParseError &e) {
+    return app.exit(e);
+  }
+
+  // Arguments given to all runs
+  std::vector<std::string> args_base;
+  for (const std::string &arg : app.remaining())
+    args_base.push_back(arg);
+  VioManagerOptions params_base;
+  {
+    std::vector<char *> argv_base = {argv[0]};
+    for (std::string &arg : args_base)
+      argv_base.push_back(&arg[0]);
+    params_base = parse_command_line_arguments((int)argv_base.size(), argv_base.data());
+  }
+
+  // Overrides of each run, by default each run just uses the next measurement seed
+  std::vector<std::vector<std::string>> args_runs;
+  if (!runs_file.empty()) {
+    std::ifstream file(runs_file);
+    if (!file.is_open()) {
+      printf(RED "[SIM]: unable to open runs file %s\n" RESET, runs_file.c_str());
+      return EXIT_FAILURE;
+    }
+    std::string line;
+    while (std::getline(file, line)) {
+      std::istringstream stream(line);
+      std::vector<std::string> args;
+      std::string arg;
+      while (stream >> arg)
+        args.push_back(arg);
+      if (args.empty() || args.at(0).at(0) == '#')
+        continue;
+      args_runs.push_back(args);
+    }
+  } else {
+    args_runs.resize((size_t)std::max(num_runs, 0));
+  }
+
+  // Parse the options of each run up front, as our parser will exit on any error
+  std::vector<SimRun> runs(args_runs.size());
+  for (size_t i = 0; i < runs.size(); i++) {
+    std::vector<std::string> args = merge_arguments(args_base, args_runs.at(i));
+    std::vector<char *> argv_run = {argv[0]};
+    for (std::string &arg : args)
+      argv_run.push_back(&arg[0]);
+    runs.at(i).id = i;
+    runs.at(i).params = parse_command_line_arguments((int)argv_run.size(), argv_run.data());
+    bool has_seed = std::any_of(args_runs.at(i).begin(), args_runs.at(i).end(),
+                                [](const std::string &arg) { return arg.rfind("--sim_seed_measurements", 0) == 0; });
+    if (!has_seed)
+      runs.at(i).params.sim_seed_measurements = params_base.sim_seed_measurements + (int)i;
+
+    // Each run saves into its own directory so they never write into the same file
+    char name[32];
+    snprintf(name, sizeof(name), "run_%03zu", i);
+    runs.at(i).directory = output_dir + "/" + name;
+    runs.at(i).params.record_timing_filepath = runs.at(i).directory + "/timing.txt";
+    if (!runs.at(i).params.log_directory.empty())
+      runs.at(i).params.log_directory = runs.at(i).directory;
+    boost::filesystem::create_directories(runs.at(i).directory);
+  }
+
+  // Simulate our runs across our threads, each thread takes the next run once it is done with its last
+  printf(GREEN "[SIM]: simulating %zu runs on %d threads into %s\n" RESET, runs.size(), num_threads, output_dir.c_str());
+  boost::posix_time::ptime rT1 = boost::posix_time::microsec_clock::local_time();
+  std::atomic<size_t> next_run(0);
+  std::atomic<size_t> num_failed(0);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < std::min(num_threads, (int)runs.size()); t++) {
+    threads.emplace_back([&]() {
+      size_t i;
+      while ((i = next_run++) < runs.size()) {
+        boost::posix_time::ptime rT_run = boost::posix_time::microsec_clock::local_time();
+        bool success = run_simulation(runs.at(i));
+        double time_run = (boost::posix_time::microsec_clock::local_time() - rT_run).total_microseconds() * 1e-6;
+        if (success) {
+          printf(GREEN "[SIM]: run %zu (seed %d) finished in %.2f seconds\n" RESET, i, runs.at(i).params.sim_seed_measurements, time_run);
+        } else {
+          num_failed++;
+        }
+      }
+    });
+  }
+  for (std::thread &thread : threads)
+    thread.join();
+
+  // Done!
+  double time_total = (boost::posix_time::microsec_clock::local_time() - rT1).total_microseconds() * 1e-6;
+  printf(GREEN "[SIM]: finished %zu runs (%zu failed) in %.2f seconds\n" RESET, runs.size(), num_failed.load(), time_total);
+  return (num_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -56,7 +56,6 @@ void Propagator::propagate_and_clone(std::shared_ptr<State> state, double timest
   // First lets construct an IMU vector of measurements we need
   double time0 = state->_timestamp + last_prop_time_offset;
   double time1 = timestamp + t_off_new;
-  std::vector<ov_core::ImuData> prop_data = Propagator::select_imu_readings(imu_data, time0, time1);
 
   // We are going to sum up all the state transition matrices, so we can do a single large multiplication at the end
   // Phi_summed = Phi_i*Phi_summed
@@ -67,8 +66,24 @@ void Propagator::propagate_and_clone(std::shared_ptr<State> state, double timest
   Eigen::Matrix<double, 15, 15> Qd_summed = Eigen::Matrix<double, 15, 15>::Zero();
   double dt_summed = 0;
 
-  // Loop through all IMU messages, and use them to move the state forward in time
+  // Last angular velocity (used for cloning when estimating time offset)
+  Eigen::Matrix<double, 3, 1> last_w = Eigen::Matrix<double, 3, 1>::Zero();
+
+  // If preintegrating, the readings have already been integrated as they came in
+  // Thus we just need to apply the preintegrated measurement over the whole interval
+  if (state->_options.use_preintegration) {
+    std::shared_ptr<CpiV1> cpi = get_preintegration(state, time0, time1, last_w);
+    if (cpi != nullptr) {
+      predict_and_compute_cpi(state, cpi, Phi_summed, Qd_summed);
+      dt_summed = cpi->DT;
+    }
+  }
+
+  // Otherwise loop through all IMU messages, and use them to move the state forward in time
   // This uses the zero'th order quat, and then constant acceleration discrete
+  std::vector<ov_core::ImuData> prop_data;
+  if (!state->_options.use_preintegration)
+    prop_data = Propagator::select_imu_readings(imu_data, time0, time1);
   if (prop_data.size() > 1) {
     for (size_t i = 0; i < prop_data.size() - 1; i++) {
 
@@ -90,8 +105,7 @@ void Propagator::propagate_and_clone(std::shared_ptr<State> state, double timest
     }
   }
 
-  // Last angular velocity (used for cloning when estimating time offset)
-  Eigen::Matrix<double, 3, 1> last_w = Eigen::Matrix<double, 3, 1>::Zero();
+  // Last angular velocity of the readings we integrated
   if (prop_data.size() > 1)
     last_w = prop_data.at(prop_data.size() - 2).wm - state->_imu->bias_g();
   else if (!prop_data.empty())
@@ -106,6 +120,12 @@ void Propagator::propagate_and_clone(std::shared_ptr<State> state, double timest
   state->_timestamp = timestamp;
   last_prop_time_offset = t_off_new;
 
+  // Start preintegrating the readings of the next interval
+  if (state->_options.use_preintegration) {
+    std::lock_guard<std::mutex> lck(cpi_mtx);
+    reset_preintegration(state, time1);
+  }
+
   // Now perform stochastic cloning
   // 状态增广
   StateHelper::augment_clone(state, last_w);
@@ -179,6 +199,22 @@ void Propagator::fast_state_propagate(std::shared_ptr<State> state, double times
   state->_imu->set_fej(orig_fej);
 }
 
+bool Propagator::integrate_rotation(double time0, double time1, const Eigen::Vector3d &bias_g, Eigen::Matrix3d &R_0to1) {
+
+  // Get the readings we need
+  std::vector<ov_core::ImuData> prop_data = Propagator::select_imu_readings(imu_data, time0, time1, false);
+  if (prop_data.size() < 2)
+    return false;
+
+  // Zero'th order integration of the orientation, same as our mean propagation
+  R_0to1.setIdentity();
+  for (size_t i = 0; i < prop_data.size() - 1; i++) {
+    double dt = prop_data.at(i + 1).timestamp - prop_data.at(i).timestamp;
+    R_0to1 = exp_so3(-(prop_data.at(i).wm - bias_g) * dt) * R_0to1;
+  }
+  return true;
+}
+
 std::vector<ov_core::ImuData> Propagator::select_imu_readings(const std::vector<ov_core::ImuData> &imu_data, double time0, double time1,
                                                               bool warn) {
 
@@ -410,6 +446,190 @@ void Propagator::predict_and_compute(std::shared_ptr<State> state, const ov_core
   state->_imu->set_fej(imu_x);
 }
 
+void Propagator::feed_preintegration(const ov_core::ImuData &message) {
+
+  // Nothing to do if we are not preintegrating, or this reading is not newer
+  // Note that we skip readings with a zero dt to the last (see select_imu_readings())
+  if (cpi_running == nullptr || message.timestamp - cpi_last.timestamp < 1e-12)
+    return;
+
+  // Stop if we have not propagated in a long time, the next propagation will integrate from the buffer
+  if (cpi_num_readings >= cpi_max_readings) {
+    printf(YELLOW "Propagator::feed_preintegration(): preintegrated %d readings without propagating, stopping!\n" RESET,
+           (int)cpi_num_readings);
+    cpi_running = nullptr;
+    cpi_snapshots.clear();
+    return;
+  }
+
+  // Integrate from the last reading to this one
+  cpi_running->feed_IMU(cpi_last.timestamp, message.timestamp, cpi_last.wm, cpi_last.am, message.wm, message.am);
+  cpi_last = message;
+  cpi_num_readings++;
+
+  // Every few readings keep a copy, so we can later get the preintegration up to a time before the newest reading
+  if (cpi_num_readings % cpi_snapshot_readings == 0 && cpi_snapshots.size() < cpi_max_snapshots)
+    cpi_snapshots.emplace_back(message, *cpi_running);
+}
+
+std::shared_ptr<CpiV1> Propagator::get_preintegration(std::shared_ptr<State> state, double time0, double time1, Eigen::Vector3d &last_w) {
+
+  // If our running preintegration started at this time, we start from its last copy before the end time
+  // NOTE: the first copy is always at the start time, so we will always find one
+  std::unique_lock<std::mutex> lck(cpi_mtx);
+  if (cpi_running != nullptr && cpi_start_time == time0 && time1 > time0) {
+    auto it = std::lower_bound(cpi_snapshots.begin(), cpi_snapshots.end(), time1,
+                               [](const CpiSnapshot &entry, double t) { return entry.first.timestamp < t; });
+    std::shared_ptr<CpiV1> cpi = std::make_shared<CpiV1>((it - 1)->second);
+    ov_core::ImuData data_minus = (it - 1)->first;
+    lck.unlock();
+
+    // Integrate the readings after this copy, the last one before the end time is integrated up to the end time
+    std::vector<ov_core::ImuData> readings = imu_data->get_bounding(data_minus.timestamp, time1);
+    ov_core::ImuData data_plus = data_minus;
+    bool have_next = false;
+    for (const ov_core::ImuData &data : readings) {
+      if (data.timestamp - data_minus.timestamp < 1e-12)
+        continue;
+      if (data.timestamp < time1) {
+        cpi->feed_IMU(data_minus.timestamp, data.timestamp, data_minus.wm, data_minus.am, data.wm, data.am);
+        data_minus = data;
+        continue;
+      }
+      data_plus = interpolate_data(data_minus, data, time1);
+      have_next = true;
+      break;
+    }
+
+    // If we do not have a reading after the end time, then we hold the last one constant up to it
+    if (!have_next) {
+      data_plus = data_minus;
+      data_plus.timestamp = time1;
+    }
+    if (time1 - data_minus.timestamp > 1e-12)
+      cpi->feed_IMU(data_minus.timestamp, time1, data_minus.wm, data_minus.am, data_plus.wm, data_plus.am);
+    last_w = data_minus.wm - state->_imu->bias_g();
+    return cpi;
+  }
+  lck.unlock();
+
+  // Otherwise we need to integrate all the readings in this interval
+  std::vector<ov_core::ImuData> prop_data = Propagator::select_imu_readings(imu_data, time0, time1);
+  if (prop_data.size() < 2)
+    return nullptr;
+  std::shared_ptr<CpiV1> cpi = std::make_shared<CpiV1>(_noises.sigma_w, _noises.sigma_wb, _noises.sigma_a, _noises.sigma_ab,
+                                                       state->_options.imu_avg);
+  cpi->setLinearizationPoints(state->_imu->bias_g(), state->_imu->bias_a());
+  for (size_t i = 0; i < prop_data.size() - 1; i++) {
+    cpi->feed_IMU(prop_data.at(i).timestamp, prop_data.at(i + 1).timestamp, prop_data.at(i).wm, prop_data.at(i).am,
+                  prop_data.at(i + 1).wm, prop_data.at(i + 1).am);
+  }
+
+  // If we do not have a reading after the end time, then we hold the last one constant up to it
+  const ov_core::ImuData &data_last = prop_data.at(prop_data.size() - 1);
+  if (time1 - data_last.timestamp > 1e-12)
+    cpi->feed_IMU(data_last.timestamp, time1, data_last.wm, data_last.am, data_last.wm, data_last.am);
+  last_w = prop_data.at(prop_data.size() - 2).wm - state->_imu->bias_g();
+  return cpi;
+}
+
+void Propagator::reset_preintegration(std::shared_ptr<State> state, double time0) {
+
+  // Find the first reading after the start time, we need it to interpolate to the start time
+  cpi_running = nullptr;
+  cpi_snapshots.clear();
+  cpi_num_readings = 0;
+  std::vector<ov_core::ImuData> readings = imu_data->get_bounding(time0, INFINITY);
+  size_t j = 0;
+  while (j < readings.size() && readings.at(j).timestamp <= time0)
+    j++;
+  if (j == 0 || j == readings.size())
+    return;
+
+  // Start with an empty preintegration at the start time, linearized about our current biases
+  // NOTE: clearing the copies keeps their memory, so after the first interval we do not allocate them again
+  cpi_running = std::make_shared<CpiV1>(_noises.sigma_w, _noises.sigma_wb, _noises.sigma_a, _noises.sigma_ab, state->_options.imu_avg);
+  cpi_running->setLinearizationPoints(state->_imu->bias_g(), state->_imu->bias_a());
+  cpi_start_time = time0;
+  cpi_last = readings.at(j - 1);
+  if (cpi_last.timestamp != time0)
+    cpi_last = interpolate_data(readings.at(j - 1), readings.at(j), time0);
+  cpi_snapshots.reserve(cpi_max_snapshots);
+  cpi_snapshots.emplace_back(cpi_last, *cpi_running);
+
+  // Integrate all readings we already have after the start time
+  for (size_t i = j; i < readings.size(); i++) {
+    feed_preintegration(readings.at(i));
+  }
+}
+
+void Propagator::predict_and_compute_cpi(std::shared_ptr<State> state, const std::shared_ptr<CpiV1> &cpi, Eigen::Matrix<double, 15, 15> &F,
+                                         Eigen::Matrix<double, 15, 15> &Qd) {
+
+  // Correct the preintegrated measurement to our current bias estimates
+  double DT = cpi->DT;
+  Eigen::Vector3d dbg = state->_imu->bias_g() - cpi->b_w_lin;
+  Eigen::Vector3d dba = state->_imu->bias_a() - cpi->b_a_lin;
+  Eigen::Matrix<double, 3, 3> R_k2k1 = exp_so3(cpi->J_q * dbg) * cpi->R_k2tau;
+  Eigen::Vector3d alpha = cpi->alpha_tau + cpi->J_a * dbg + cpi->H_a * dba;
+  Eigen::Vector3d beta = cpi->beta_tau + cpi->J_b * dbg + cpi->H_b * dba;
+
+  // Compute the new state mean value
+  Eigen::Matrix<double, 3, 3> R_Gtoi = state->_imu->Rot();
+  Eigen::Vector4d new_q = rot_2_quat(R_k2k1 * R_Gtoi);
+  Eigen::Vector3d new_v = state->_imu->vel() - _gravity * DT + R_Gtoi.transpose() * beta;
+  Eigen::Vector3d new_p = state->_imu->pos() + state->_imu->vel() * DT - 0.5 * _gravity * DT * DT + R_Gtoi.transpose() * alpha;
+
+  // Get the locations of each entry of the imu state
+  int th_id = state->_imu->q()->id() - state->_imu->id();
+  int p_id = state->_imu->p()->id() - state->_imu->id();
+  int v_id = state->_imu->v()->id() - state->_imu->id();
+  int bg_id = state->_imu->bg()->id() - state->_imu->id();
+  int ba_id = state->_imu->ba()->id() - state->_imu->id();
+
+  // Linearization point of the start of the interval (first estimates if using FEJ)
+  // The rotation change dR then includes the "k-th" updated orientation information like the discrete propagation
+  Eigen::Matrix<double, 3, 3> R_lin = (state->_options.do_fej) ? state->_imu->Rot_fej() : R_Gtoi;
+  Eigen::Vector3d v_lin = (state->_options.do_fej) ? state->_imu->vel_fej() : state->_imu->vel();
+  Eigen::Vector3d p_lin = (state->_options.do_fej) ? state->_imu->pos_fej() : state->_imu->pos();
+  Eigen::Matrix<double, 3, 3> dR = quat_2_Rot(new_q) * R_lin.transpose();
+
+  // Now compute Jacobian of new state wrt old state
+  F.setZero();
+  F.block(th_id, th_id, 3, 3) = dR;
+  F.block(th_id, bg_id, 3, 3) = -cpi->J_q;
+  F.block(bg_id, bg_id, 3, 3).setIdentity();
+  F.block(v_id, th_id, 3, 3).noalias() = -skew_x(new_v - v_lin + _gravity * DT) * R_lin.transpose();
+  F.block(v_id, v_id, 3, 3).setIdentity();
+  F.block(v_id, bg_id, 3, 3).noalias() = R_lin.transpose() * cpi->J_b;
+  F.block(v_id, ba_id, 3, 3).noalias() = R_lin.transpose() * cpi->H_b;
+  F.block(ba_id, ba_id, 3, 3).setIdentity();
+  F.block(p_id, th_id, 3, 3).noalias() = -skew_x(new_p - p_lin - v_lin * DT + 0.5 * _gravity * DT * DT) * R_lin.transpose();
+  F.block(p_id, v_id, 3, 3) = Eigen::Matrix<double, 3, 3>::Identity() * DT;
+  F.block(p_id, bg_id, 3, 3).noalias() = R_lin.transpose() * cpi->J_a;
+  F.block(p_id, ba_id, 3, 3).noalias() = R_lin.transpose() * cpi->H_a;
+  F.block(p_id, p_id, 3, 3).setIdentity();
+
+  // The preintegrated measurement covariance is ordered (q, bg, beta, ba, alpha) with beta and alpha in the frame at the start
+  // Thus we just need to rotate these into the global frame to get the noise injected into our state
+  Eigen::Matrix<double, 15, 15> G = Eigen::Matrix<double, 15, 15>::Zero();
+  G.block(th_id, 0, 3, 3).setIdentity();
+  G.block(bg_id, 3, 3, 3).setIdentity();
+  G.block(v_id, 6, 3, 3) = R_lin.transpose();
+  G.block(ba_id, 9, 3, 3).setIdentity();
+  G.block(p_id, 12, 3, 3) = R_lin.transpose();
+  Qd = G * cpi->P_meas * G.transpose();
+  Qd = 0.5 * (Qd + Qd.transpose());
+
+  // Now replace imu estimate and fej with propagated values
+  Eigen::Matrix<double, 16, 1> imu_x = state->_imu->value();
+  imu_x.block(0, 0, 4, 1) = new_q;
+  imu_x.block(4, 0, 3, 1) = new_p;
+  imu_x.block(7, 0, 3, 1) = new_v;
+  state->_imu->set_value(imu_x);
+  state->_imu->set_fej(imu_x);
+}
+
 void Propagator::predict_mean_discrete(std::shared_ptr<State> state, double dt, const Eigen::Vector3d &w_hat1,
                                        const Eigen::Vector3d &a_hat1, const Eigen::Vector3d &w_hat2, const Eigen::Vector3d &a_hat2,
                                        Eigen::Vector4d &new_q, Eigen::Vector3d &new_v, Eigen::Vector3d &new_p) {
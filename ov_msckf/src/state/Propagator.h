@@ -22,7 +22,12 @@
 #ifndef OV_MSCKF_STATE_PROPAGATOR_H
 #define OV_MSCKF_STATE_PROPAGATOR_H
 
+#include <mutex>
+#include <vector>
+
+#include "cpi/CpiV1.h"
 #include "state/StateHelper.h"
+#include "utils/imu_buffer.h"
 #include "utils/quat_ops.h"
 #include "utils/sensor_data.h"
 
@@ -36,6 +41,11 @@ namespace ov_msckf {
  * We will first select what measurements we need to propagate with.
  * We then compute the state transition matrix at each step and update the state and covariance.
  * For derivations look at @ref propagation page which has detailed equations.
+ *
+ * If StateOptions::use_preintegration is set, we instead keep a continuous preintegration (ov_core::CpiV1) of the readings
+ * since the last propagation which is extended in feed_imu() as each reading arrives.
+ * Every few readings we keep a copy of it, so at camera time we start from the last copy before the camera time,
+ * integrate the few readings after it, and apply a single mean and covariance step.
  */
 class Propagator {
 
@@ -82,14 +92,19 @@ public:
    * @brief Default constructor
    * @param noises imu noise characteristics (continuous time)
    * @param gravity_mag Global gravity magnitude of the system (normally 9.81)
+   * @param imu_buffer Inertial readings buffer to use (can be shared with others), if null we will create our own
    */
-  Propagator(NoiseManager noises, double gravity_mag) : _noises(noises) {
+  Propagator(NoiseManager noises, double gravity_mag, std::shared_ptr<ov_core::ImuBuffer> imu_buffer = nullptr)
+      : _noises(noises), imu_data(imu_buffer) {
     _noises.sigma_w_2 = std::pow(_noises.sigma_w, 2);
     _noises.sigma_a_2 = std::pow(_noises.sigma_a, 2);
     _noises.sigma_wb_2 = std::pow(_noises.sigma_wb, 2);
     _noises.sigma_ab_2 = std::pow(_noises.sigma_ab, 2);
     last_prop_time_offset = 0.0;
     _gravity << 0.0, 0.0, gravity_mag;
+    if (imu_data == nullptr) {
+      imu_data = std::make_shared<ov_core::ImuBuffer>(10.0);
+    }
   }
 
   /**
@@ -97,23 +112,17 @@ public:
    * @param message Contains our timestamp and inertial information
    */
   void feed_imu(const ov_core::ImuData &message) {
-
-    // Append it to our vector
-    imu_data.emplace_back(message);
-
-    // Loop through and delete imu messages that are older then 10 seconds
-    // TODO: we should probably have more elegant logic then this
-    // TODO: but this prevents unbounded memory growth and slow prop with high freq imu
-    auto it0 = imu_data.begin();
-    while (it0 != imu_data.end()) {
-      if (message.timestamp - (*it0).timestamp > 10) {
-        it0 = imu_data.erase(it0);
-      } else {
-        it0++;
-      }
-    }
+    // Append it to our buffer
+    // This will also drop any readings that are older then the buffer's max time (10 seconds by default)
+    // If we are preintegrating, also integrate this reading now so it does not need to be done at camera time
+    std::lock_guard<std::mutex> lck(cpi_mtx);
+    imu_data->feed(message);
+    feed_preintegration(message);
   }
 
+  /// Accessor to our buffer of inertial readings
+  std::shared_ptr<ov_core::ImuBuffer> get_imu_buffer() { return imu_data; }
+
   /**
    * @brief Propagate state up to given timestamp and then clone
    *
@@ -141,6 +150,21 @@ public:
    */
   void fast_state_propagate(std::shared_ptr<State> state, double timestamp, Eigen::Matrix<double, 13, 1> &state_plus);
 
+  /**
+   * @brief Integrates the gyroscope between two times to get how the IMU has rotated.
+   *
+   * This only uses the inertial readings and does not touch the state.
+   * It is typically used to predict the rotation of the cameras between two images (e.g. for feature tracking).
+   * The timestamps passed should already take into account the time offset values.
+   *
+   * @param time0 Start timestamp
+   * @param time1 End timestamp
+   * @param bias_g Gyroscope bias we should remove from the readings
+   * @param R_0to1 Rotation from the IMU frame at the start time to the IMU frame at the end time
+   * @return False if we did not have readings to integrate with
+   */
+  bool integrate_rotation(double time0, double time1, const Eigen::Vector3d &bias_g, Eigen::Matrix3d &R_0to1);
+
   /**
    * @brief Helper function that given current imu data, will select imu readings between the two times.
    *
@@ -157,6 +181,23 @@ public:
   static std::vector<ov_core::ImuData> select_imu_readings(const std::vector<ov_core::ImuData> &imu_data, double time0, double time1,
                                                            bool warn = true);
 
+  /**
+   * @brief Helper function that given an imu buffer, will select imu readings between the two times.
+   *
+   * This will first binary search the buffer for the readings which bound the two times.
+   * Then only these are passed to our vector version of this function, so we do not need to loop over the whole history.
+   *
+   * @param imu_data IMU buffer we will select measurements from
+   * @param time0 Start timestamp
+   * @param time1 End timestamp
+   * @param warn If we should warn if we don't have enough IMU to propagate with (e.g. fast prop will get warnings otherwise)
+   * @return Vector of measurements (if we could compute them)
+   */
+  static std::vector<ov_core::ImuData> select_imu_readings(const std::shared_ptr<ov_core::ImuBuffer> &imu_data, double time0,
+                                                           double time1, bool warn = true) {
+    return select_imu_readings(imu_data->get_bounding(time0, time1), time0, time1, warn);
+  }
+
   /**
    * @brief Nice helper function that will linearly interpolate between two imu messages.
    *
@@ -184,6 +225,63 @@ protected:
   double last_prop_time_offset = 0.0;
   bool have_last_prop_time_offset = false;
 
+  /**
+   * @brief Extends our running preintegration with a new reading (cpi_mtx should be locked)
+   * @param message Newest inertial reading
+   */
+  void feed_preintegration(const ov_core::ImuData &message);
+
+  /**
+   * @brief Gets the preintegration over the interval between two times.
+   *
+   * If our running preintegration starts at the first time we take its last snapshot before the end time, and only integrate the
+   * readings after it. Otherwise (e.g. on startup, or if something else moved the state time) we will integrate all readings in the buffer.
+   * If we do not have a reading after the end time, the last reading is held constant up to it.
+   *
+   * @param state Pointer to state (the current biases are used as the linearization point if we need to integrate from scratch)
+   * @param time0 Start timestamp
+   * @param time1 End timestamp
+   * @param last_w Angular velocity of the last reading in the interval, with bias removed (used for cloning)
+   * @return Preintegration over the interval, null if we did not have the readings to compute it
+   */
+  std::shared_ptr<ov_core::CpiV1> get_preintegration(std::shared_ptr<State> state, double time0, double time1, Eigen::Vector3d &last_w);
+
+  /**
+   * @brief Starts a new running preintegration from the given time using the current bias estimates.
+   *
+   * Any readings we already have after this time will be integrated right away.
+   * If we do not yet have a reading after this time we do not start, and the next propagation will use the buffer.
+   *
+   * @param state Pointer to state
+   * @param time0 Start timestamp
+   */
+  void reset_preintegration(std::shared_ptr<State> state, double time0);
+
+  /**
+   * @brief Propagates the state forward using a preintegrated measurement and computes the noise covariance and
+   * state-transition matrix of the whole interval.
+   *
+   * The preintegration was linearized about older bias estimates, thus we first correct it to the current biases using its bias Jacobians.
+   * \f{align*}{
+   * \text{}^{I_{k+1}}_{G}\hat{\mathbf{R}} &= \exp(\mathbf{J}_q\Delta\mathbf{b}_g)~{}^{I_{k+1}}_{I_k}\breve{\mathbf{R}}~
+   * \text{}^{I_{k}}_{G}\hat{\mathbf{R}} \\
+   * ^G\hat{\mathbf{v}}_{I_{k+1}} &= \text{}^G\hat{\mathbf{v}}_{I_k} - {}^G\mathbf{g}\Delta T
+   * + \text{}^{I_k}_G\hat{\mathbf{R}}^\top(\breve{\boldsymbol{\beta}}
+   * + \mathbf{J}_\beta\Delta\mathbf{b}_g + \mathbf{H}_\beta\Delta\mathbf{b}_a) \\
+   * ^G\hat{\mathbf{p}}_{I_{k+1}} &= \text{}^G\hat{\mathbf{p}}_{I_k} + {}^G\hat{\mathbf{v}}_{I_k} \Delta T
+   * - \frac{1}{2}{}^G\mathbf{g}\Delta T^2
+   * + \text{}^{I_k}_G\hat{\mathbf{R}}^\top(\breve{\boldsymbol{\alpha}}
+   * + \mathbf{J}_\alpha\Delta\mathbf{b}_g + \mathbf{H}_\alpha\Delta\mathbf{b}_a)
+   * \f}
+   *
+   * @param state Pointer to state
+   * @param cpi Preintegrated measurement over the interval
+   * @param F State-transition matrix over the interval
+   * @param Qd Discrete-time noise covariance over the interval
+   */
+  void predict_and_compute_cpi(std::shared_ptr<State> state, const std::shared_ptr<ov_core::CpiV1> &cpi, Eigen::Matrix<double, 15, 15> &F,
+                               Eigen::Matrix<double, 15, 15> &Qd);
+
   /**
    * @brief Propagates the state forward using the imu data and computes the noise covariance and state-transition
    * matrix of this interval.
@@ -266,10 +364,41 @@ protected:
   NoiseManager _noises;
 
   /// Our history of IMU messages (time, angular, linear)
-  std::vector<ov_core::ImuData> imu_data;
+  std::shared_ptr<ov_core::ImuBuffer> imu_data;
 
   /// Gravity vector
   Eigen::Vector3d _gravity;
+
+  /// Mutex lock for our running preintegration (readings are fed from a different thread then we propagate on)
+  std::mutex cpi_mtx;
+
+  /// Running preintegration from the start time up to the newest reading it has integrated (null if not started)
+  std::shared_ptr<ov_core::CpiV1> cpi_running;
+
+  /// Start time of our running preintegration
+  double cpi_start_time = -1;
+
+  /// Newest reading integrated into our running preintegration
+  ov_core::ImuData cpi_last;
+
+  /// Number of readings integrated into our running preintegration
+  size_t cpi_num_readings = 0;
+
+  /// Copy of our running preintegration along with the newest reading it has integrated
+  typedef std::pair<ov_core::ImuData, ov_core::CpiV1> CpiSnapshot;
+
+  /// Copies of the running preintegration taken every few readings
+  /// The first is the empty preintegration at the start time, after the max number we only keep the running preintegration
+  std::vector<CpiSnapshot, Eigen::aligned_allocator<CpiSnapshot>> cpi_snapshots;
+
+  /// Number of readings between each copy of our running preintegration
+  size_t cpi_snapshot_readings = 5;
+
+  /// Max number of copies of our running preintegration
+  size_t cpi_max_snapshots = 64;
+
+  /// Max number of readings we preintegrate before giving up (e.g. if we stopped getting images)
+  size_t cpi_max_readings = 5000;
 };
 
 } // namespace ov_msckf
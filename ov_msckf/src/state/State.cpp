@@ -74,8 +74,29 @@ State::State(StateOptions &options) {
     }
   }
 
+  // GPS antenna lever arm and the transform from our global frame into the ENU frame of the GPS
+  _calib_IMUtoGPS = std::make_shared<Vec>(3);
+  if (_options.do_calib_gps_leverarm) {
+    _calib_IMUtoGPS->set_local_id(current_id);
+    _variables.push_back(_calib_IMUtoGPS);
+    current_id += _calib_IMUtoGPS->size();
+  }
+  _calib_GtoENU = std::make_shared<Vec>(4);
+  if (_options.do_calib_gps_frame) {
+    _calib_GtoENU->set_local_id(current_id);
+    _variables.push_back(_calib_GtoENU);
+    current_id += _calib_GtoENU->size();
+  }
+
   // Finally initialize our covariance to small value
-  _Cov = 1e-3 * Eigen::MatrixXd::Identity(current_id, current_id);
+  // We also reserve a free slot for each clone (and the one before marginalization), these are zero until used
+  int num_reserved = 6 * (_options.max_clone_size + 1);
+  _Cov = Eigen::MatrixXd::Zero(current_id + num_reserved, current_id + num_reserved);
+  _Cov.block(0, 0, current_id, current_id) = 1e-3 * Eigen::MatrixXd::Identity(current_id, current_id);
+  for (int id = current_id; id < current_id + num_reserved; id += 6) {
+    _Cov_free[6].push_back(id);
+  }
+  _Cov_free_size = num_reserved;
 
   // Finally, set some of our priors for our calibration parameters
   if (_options.do_calib_camera_timeoffset) {
@@ -88,6 +109,14 @@ State::State(StateOptions &options) {
           std::pow(0.01, 2) * Eigen::MatrixXd::Identity(3, 3);
     }
   }
+  if (_options.do_calib_gps_leverarm) {
+    _Cov.block(_calib_IMUtoGPS->id(), _calib_IMUtoGPS->id(), 3, 3) = std::pow(0.1, 2) * Eigen::MatrixXd::Identity(3, 3);
+  }
+  if (_options.do_calib_gps_frame) {
+    // NOTE: we do not know the yaw of our global frame at all, while its origin is the first fix up to the GPS noise
+    _Cov(_calib_GtoENU->id(), _calib_GtoENU->id()) = std::pow(M_PI, 2);
+    _Cov.block(_calib_GtoENU->id() + 1, _calib_GtoENU->id() + 1, 3, 3) = std::pow(1.0, 2) * Eigen::MatrixXd::Identity(3, 3);
+  }
   if (_options.do_calib_camera_intrinsics) {
     for (int i = 0; i < _options.num_cameras; i++) {
       _Cov.block(_cam_intrinsics.at(i)->id(), _cam_intrinsics.at(i)->id(), 4, 4) = std::pow(1.0, 2) * Eigen::MatrixXd::Identity(4, 4);
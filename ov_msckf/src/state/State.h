@@ -76,9 +76,9 @@ public:
 
   /**
    * @brief Calculates the current max size of the covariance
-   * @return Size of the current covariance matrix
+   * @return Size of the covariance of all active variables (our free slots are not counted)
    */
-  int max_covariance_size() { return (int)_Cov.rows(); }
+  int max_covariance_size() { return (int)_Cov.rows() - _Cov_free_size; }
 
   /// Current timestamp (should be the last update time!)
   double _timestamp;
@@ -107,6 +107,12 @@ public:
   /// Camera intrinsics camera objects
   std::unordered_map<size_t, std::shared_ptr<CamBase>> _cam_intrinsics_cameras;
 
+  /// Position of the GPS antenna in the IMU frame (p_GPSinI)
+  std::shared_ptr<Vec> _calib_IMUtoGPS;
+
+  /// Yaw of our global frame and its origin in the ENU frame of the GPS (yaw_GtoENU, p_GinENU)
+  std::shared_ptr<Vec> _calib_GtoENU;
+
 private:
   // Define that the state helper is a friend class of this class
   // This will allow it to access the below functions which should normally not be called
@@ -116,6 +122,18 @@ private:
   /// Covariance of all active variables
   Eigen::MatrixXd _Cov;
 
+  /**
+   * @brief Free slots of our covariance (their ids mapped by their size)
+   *
+   * When a variable is marginalized its rows and columns are zeroed and its slot is added here.
+   * New variables of the same size are then placed into a free slot, so the covariance does not need to be resized.
+   * We start with a free slot for each clone of our sliding window, thus the steady state window does not reallocate.
+   */
+  std::map<int, std::vector<int>> _Cov_free;
+
+  /// Total size of all free slots of our covariance
+  int _Cov_free_size = 0;
+
   /// Vector of variables
   std::vector<std::shared_ptr<Type>> _variables;
 };
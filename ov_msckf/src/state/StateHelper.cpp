@@ -184,37 +184,6 @@ void StateHelper::EKFUpdate(std::shared_ptr<State> state, const std::vector<std:
 }
 
 
-void StateHelper::EKFUpdate(std::shared_ptr<State> state, const Eigen::MatrixXd &H, const Eigen::VectorXd &res, const Eigen::MatrixXd &R)
-{
-  const Eigen::MatrixXd P_minus = StateHelper::get_full_covariance(state);
-  const Eigen::MatrixXd H_trans = H.transpose();
-  const Eigen::MatrixXd S = H * P_minus * H_trans + R;
-  const Eigen::MatrixXd S_inv = S.llt().solve(Eigen::MatrixXd::Identity(S.rows(), S.cols()));
-  const Eigen::MatrixXd K = P_minus * H_trans * S_inv;
-  const Eigen::VectorXd delta_x = K * res;
-
-  // std::cout << P_minus.size() << std::endl;
-
-  // std::cout << delta_x.size() << std::endl;
-
-  
-
-  // std::cout << delta_x.block(state->_imu->id(), 0, state->_imu->size(), 1).transpose() << std::endl;
-
-  const Eigen::MatrixXd I_KH = Eigen::MatrixXd::Identity(state->_Cov.rows(), state->_Cov.rows()) - K * H;
-  state->_Cov = I_KH * P_minus * I_KH.transpose() + K * R * K.transpose();
-  state->_Cov = state->_Cov.eval().selfadjointView<Eigen::Upper>();
-  LimitMinDiagValue(1e-12, &state->_Cov);
-
-  for (size_t i = 0; i < state->_variables.size(); i++) {
-    state->_variables.at(i)->update(delta_x.block(state->_variables.at(i)->id(), 0, state->_variables.at(i)->size(), 1));
-  }
-
-  // state->_imu->update(delta_x.block(state->_imu->id(), 0, state->_imu->size(), 1));
-  
-}
-
-
 void StateHelper::fix_4dof_gauge_freedoms(std::shared_ptr<State> state, const Eigen::Vector4d &q_GtoI) {
 
   // Fix our global yaw and position
@@ -290,47 +259,26 @@ void StateHelper::marginalize(std::shared_ptr<State> state, std::shared_ptr<Type
   //
   //  to
   //
-  //  P_(x_1,x_1) P(x_1,x_2)
-  //  P_(x_2,x_1) P(x_2,x_2)
+  //  P_(x_1,x_1) 0 P(x_1,x_2)
+  //  0           0 0
+  //  P_(x_2,x_1) 0 P(x_2,x_2)
   //
-  // i.e. x_1 goes from 0 to marg_id, x_2 goes from marg_id+marg_size to Cov.rows() in the original covariance
-
+  // i.e. we just zero the rows and columns of x_m and keep its slot free for the next variable of the same size
   int marg_size = marg->size();
   int marg_id = marg->id();
-  int x2_size = (int)state->_Cov.rows() - marg_id - marg_size;
-
-  Eigen::MatrixXd Cov_new(state->_Cov.rows() - marg_size, state->_Cov.rows() - marg_size);
-
-  // P_(x_1,x_1)
-  Cov_new.block(0, 0, marg_id, marg_id) = state->_Cov.block(0, 0, marg_id, marg_id);
-
-  // P_(x_1,x_2)
-  Cov_new.block(0, marg_id, marg_id, x2_size) = state->_Cov.block(0, marg_id + marg_size, marg_id, x2_size);
-
-  // P_(x_2,x_1)
-  Cov_new.block(marg_id, 0, x2_size, marg_id) = Cov_new.block(0, marg_id, marg_id, x2_size).transpose();
-
-  // P(x_2,x_2)
-  Cov_new.block(marg_id, marg_id, x2_size, x2_size) = state->_Cov.block(marg_id + marg_size, marg_id + marg_size, x2_size, x2_size);
+  state->_Cov.block(0, marg_id, state->_Cov.rows(), marg_size).setZero();
+  state->_Cov.block(marg_id, 0, marg_size, state->_Cov.rows()).setZero();
+  state->_Cov_free[marg_size].push_back(marg_id);
+  state->_Cov_free_size += marg_size;
 
-  // Now set new covariance
-  // state->_Cov.resize(Cov_new.rows(),Cov_new.cols());
-  state->_Cov = Cov_new;
-  // state->Cov() = 0.5*(Cov_new+Cov_new.transpose());
-  assert(state->_Cov.rows() == Cov_new.rows());
-
-  // Now we keep the remaining variables and update their ordering
+  // Remove it from our variables
   // Note: DOES NOT SUPPORT MARGINALIZING SUBVARIABLES YET!!!!!!!
-  std::vector<std::shared_ptr<Type>> remaining_variables;
-  for (size_t i = 0; i < state->_variables.size(); i++) {
-    // Only keep non-marginal states
-    if (state->_variables.at(i) != marg) {
-      if (state->_variables.at(i)->id() > marg_id) {
-        // If the variable is "beyond" the marginal one in ordering, need to "move it forward"
-        state->_variables.at(i)->set_local_id(state->_variables.at(i)->id() - marg_size);
-      }
-      remaining_variables.push_back(state->_variables.at(i));
-    }
+  state->_variables.erase(std::find(state->_variables.begin(), state->_variables.end(), marg));
+
+  // If more than half of our covariance is free, then actually remove the free rows and columns
+  // This normally only happens if we lose a lot of SLAM features, since our clones reuse the slot of the marginalized one
+  if (2 * state->_Cov_free_size > state->_Cov.rows()) {
+    compact_covariance(state);
   }
 
   // Delete the old state variable to free up its memory
@@ -338,20 +286,14 @@ void StateHelper::marginalize(std::shared_ptr<State> state, std::shared_ptr<Type
   // NOTE: thus this is automatically managed, but this allows outside references to keep the old variable
   // delete marg;
   marg->set_local_id(-1);
-
-  // Now set variables as the remaining ones
-  state->_variables = remaining_variables;
 }
 
 std::shared_ptr<Type> StateHelper::clone(std::shared_ptr<State> state, std::shared_ptr<Type> variable_to_clone) {
 
-  // Get total size of new cloned variables, and the old covariance size
+  // Get total size of new cloned variables, and where in the covariance it will be
   int total_size = variable_to_clone->size();
-  int old_size = (int)state->_Cov.rows();
-  int new_loc = (int)state->_Cov.rows();
-
-  // Resize both our covariance to the new size
-  state->_Cov.conservativeResizeLike(Eigen::MatrixXd::Zero(old_size + total_size, old_size + total_size));
+  int new_loc = allocate_covariance(state, total_size);
+  int cov_size = (int)state->_Cov.rows();
 
   // What is the new state, and variable we inserted
   const std::vector<std::shared_ptr<Type>> new_variables = state->_variables;
@@ -373,9 +315,9 @@ std::shared_ptr<Type> StateHelper::clone(std::shared_ptr<State> state, std::shar
     int old_loc = type_check->id();
 
     // Copy the covariance elements
-    state->_Cov.block(new_loc, new_loc, total_size, total_size) = state->_Cov.block(old_loc, old_loc, total_size, total_size);
-    state->_Cov.block(0, new_loc, old_size, total_size) = state->_Cov.block(0, old_loc, old_size, total_size);
-    state->_Cov.block(new_loc, 0, total_size, old_size) = state->_Cov.block(old_loc, 0, total_size, old_size);
+    // The columns are copied first, so copying the rows after also gives the diagonal block
+    state->_Cov.block(0, new_loc, cov_size, total_size) = state->_Cov.block(0, old_loc, cov_size, total_size);
+    state->_Cov.block(new_loc, 0, total_size, cov_size) = state->_Cov.block(old_loc, 0, total_size, cov_size);
 
     // Create clone from the type being cloned
     new_clone = type_check->clone();
@@ -397,7 +339,8 @@ std::shared_ptr<Type> StateHelper::clone(std::shared_ptr<State> state, std::shar
 
 bool StateHelper::initialize(std::shared_ptr<State> state, std::shared_ptr<Type> new_variable,
                              const std::vector<std::shared_ptr<Type>> &H_order, Eigen::MatrixXd &H_R, Eigen::MatrixXd &H_L,
-                             Eigen::MatrixXd &R, Eigen::VectorXd &res, double chi_2_mult) {
+                             Eigen::MatrixXd &R, Eigen::VectorXd &res, double chi_2_mult,
+                             std::shared_ptr<ChiSquaredTable> chi_squared_table) {
 
   // Check that this new variable is not already initialized
   if (std::find(state->_variables.begin(), state->_variables.end(), new_variable) != state->_variables.end()) {
@@ -468,8 +411,7 @@ bool StateHelper::initialize(std::shared_ptr<State> state, std::shared_ptr<Type>
   double chi2 = resup.dot(S.llt().solve(resup));
 
   // Get what our threshold should be
-  boost::math::chi_squared chi_squared_dist(res.rows());
-  double chi2_check = boost::math::quantile(chi_squared_dist, 0.95);
+  double chi2_check = chi_squared_table->quantile((int)res.rows());
   if (chi2 > chi_2_mult * chi2_check) {
     return false;
   }
@@ -562,22 +504,92 @@ void StateHelper::initialize_invertible(std::shared_ptr<State> state, std::share
   Eigen::MatrixXd P_LL = H_Linv * M.selfadjointView<Eigen::Upper>() * H_Linv.transpose();
 
   // Augment the covariance matrix
-  size_t oldSize = state->_Cov.rows();
-  state->_Cov.conservativeResizeLike(Eigen::MatrixXd::Zero(oldSize + new_variable->size(), oldSize + new_variable->size()));
-  state->_Cov.block(0, oldSize, oldSize, new_variable->size()).noalias() = -M_a * H_Linv.transpose();
-  state->_Cov.block(oldSize, 0, new_variable->size(), oldSize) = state->_Cov.block(0, oldSize, oldSize, new_variable->size()).transpose();
-  state->_Cov.block(oldSize, oldSize, new_variable->size(), new_variable->size()) = P_LL;
+  // NOTE: the rows of M_a for the new location are zero if we reuse a free slot, so the diagonal block is set after
+  int oldSize = (int)M_a.rows();
+  int new_loc = allocate_covariance(state, new_variable->size());
+  state->_Cov.block(0, new_loc, oldSize, new_variable->size()).noalias() = -M_a * H_Linv.transpose();
+  state->_Cov.block(new_loc, 0, new_variable->size(), oldSize) = state->_Cov.block(0, new_loc, oldSize, new_variable->size()).transpose();
+  state->_Cov.block(new_loc, new_loc, new_variable->size(), new_variable->size()) = P_LL;
 
   // Update the variable that will be initialized (invertible systems can only update the new variable).
   // However this update should be almost zero if we already used a conditional Gauss-Newton to solve for the initial estimate
   new_variable->update(H_Linv * res);
 
   // Now collect results, and add it to the state variables
-  new_variable->set_local_id(oldSize);
+  new_variable->set_local_id(new_loc);
   state->_variables.push_back(new_variable);
   // std::cout << new_variable->id() <<  " init dx = " << (H_Linv * res).transpose() << std::endl;
 }
 
+int StateHelper::allocate_covariance(std::shared_ptr<State> state, int size) {
+
+  // Reuse a free slot if we have one of this size
+  auto it = state->_Cov_free.find(size);
+  if (it != state->_Cov_free.end()) {
+    int id = it->second.back();
+    it->second.pop_back();
+    if (it->second.empty())
+      state->_Cov_free.erase(it);
+    state->_Cov_free_size -= size;
+    return id;
+  }
+
+  // Else we need to append it to the end of our covariance
+  int old_size = (int)state->_Cov.rows();
+  state->_Cov.conservativeResizeLike(Eigen::MatrixXd::Zero(old_size + size, old_size + size));
+  return old_size;
+}
+
+void StateHelper::compact_covariance(std::shared_ptr<State> state) {
+
+  // Nothing to do if we do not have any free slots
+  if (state->_Cov_free.empty())
+    return;
+
+  // Sorted free slots, and how much each id needs to move forward
+  std::vector<std::pair<int, int>> slots_free;
+  for (const auto &pair : state->_Cov_free) {
+    for (const int &id : pair.second)
+      slots_free.push_back({id, pair.first});
+  }
+  std::sort(slots_free.begin(), slots_free.end());
+
+  // Segments of our covariance that we keep (old id, new id, size)
+  std::vector<std::tuple<int, int, int>> segments;
+  int old_id = 0, new_id = 0;
+  for (const auto &slot : slots_free) {
+    if (slot.first > old_id)
+      segments.emplace_back(old_id, new_id, slot.first - old_id);
+    new_id += slot.first - old_id;
+    old_id = slot.first + slot.second;
+  }
+  if (old_id < state->_Cov.rows())
+    segments.emplace_back(old_id, new_id, (int)state->_Cov.rows() - old_id);
+  int new_size = (int)state->_Cov.rows() - state->_Cov_free_size;
+
+  // Copy over all blocks we keep
+  Eigen::MatrixXd Cov_new(new_size, new_size);
+  for (const auto &seg_r : segments) {
+    for (const auto &seg_c : segments) {
+      Cov_new.block(std::get<1>(seg_r), std::get<1>(seg_c), std::get<2>(seg_r), std::get<2>(seg_c)) =
+          state->_Cov.block(std::get<0>(seg_r), std::get<0>(seg_c), std::get<2>(seg_r), std::get<2>(seg_c));
+    }
+  }
+  state->_Cov = Cov_new;
+
+  // Now move our variables forward by the size of the free slots before them
+  for (const auto &var : state->_variables) {
+    int shift = 0;
+    for (const auto &slot : slots_free) {
+      if (slot.first < var->id())
+        shift += slot.second;
+    }
+    var->set_local_id(var->id() - shift);
+  }
+  state->_Cov_free.clear();
+  state->_Cov_free_size = 0;
+}
+
 void StateHelper::augment_clone(std::shared_ptr<State> state, Eigen::Matrix<double, 3, 1> last_w) {
 
   // We can't insert a clone that occured at the same timestamp!
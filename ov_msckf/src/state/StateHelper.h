@@ -24,9 +24,11 @@
 
 #include "State.h"
 #include "types/Landmark.h"
+#include "utils/chi_squared_table.h"
 #include "utils/colors.h"
 
-#include <boost/math/distributions/chi_squared.hpp>
+#include <algorithm>
+#include <tuple>
 
 using namespace ov_core;
 
@@ -86,9 +88,6 @@ public:
   static void EKFUpdate(std::shared_ptr<State> state, const std::vector<std::shared_ptr<Type>> &H_order, const Eigen::MatrixXd &H,
                         const Eigen::VectorXd &res, const Eigen::MatrixXd &R);
 
-
-  static void EKFUpdate(std::shared_ptr<State> state, const Eigen::MatrixXd &H, const Eigen::VectorXd &res, const Eigen::MatrixXd &R);
-
   static void LimitMinDiagValue(const double min_diag_val, Eigen::MatrixXd* mat)
   {
     for(size_t i = 0; i < mat->rows(); ++i)
@@ -144,7 +143,9 @@ public:
    * This function can support any Type variable out of the box.
    * Right now the marginalization of a sub-variable/type is not supported.
    * For example if you wanted to just marginalize the orientation of a PoseJPL, that isn't supported.
-   * We will first remove the rows and columns corresponding to the type (i.e. do the marginalization).
+   * We will first zero the rows and columns corresponding to the type (i.e. do the marginalization).
+   * Its slot in the covariance is then kept free, so a new variable of the same size can reuse it without resizing (e.g. the next clone).
+   * If too much of our covariance is free, we remove all free rows and columns.
    * After we update all the type ids so that they take into account that the covariance has shrunk in parts of it.
    *
    * @param state Pointer to state
@@ -153,7 +154,7 @@ public:
   static void marginalize(std::shared_ptr<State> state, std::shared_ptr<Type> marg);
 
   /**
-   * @brief Clones "variable to clone" and places it at end of covariance
+   * @brief Clones "variable to clone" and places it in a free slot of the covariance (or at end if there is none)
    * @param state Pointer to state
    * @param variable_to_clone Pointer to variable that will be cloned
    */
@@ -175,10 +176,11 @@ public:
    * @param R Covariance of initializing measurements (isotropic)
    * @param res Residual of initializing measurements
    * @param chi_2_mult Value we should multiply the chi2 threshold by (larger means it will be accepted more measurements)
+   * @param chi_squared_table Table of chi2 quantiles (at the confidence level of the updater) the threshold is taken from
    */
   static bool initialize(std::shared_ptr<State> state, std::shared_ptr<Type> new_variable,
                          const std::vector<std::shared_ptr<Type>> &H_order, Eigen::MatrixXd &H_R, Eigen::MatrixXd &H_L, Eigen::MatrixXd &R,
-                         Eigen::VectorXd &res, double chi_2_mult);
+                         Eigen::VectorXd &res, double chi_2_mult, std::shared_ptr<ov_core::ChiSquaredTable> chi_squared_table);
 
   /**
    * @brief Initializes new variable into covariance (H_L must be invertible)
@@ -264,6 +266,24 @@ public:
   }
 
 private:
+  /**
+   * @brief Gets the location of a new variable in our covariance
+   *
+   * This will reuse a free slot of the same size if we have one, otherwise our covariance is grown.
+   * The rows and columns of the returned slot are zero.
+   *
+   * @param state Pointer to state
+   * @param size Size of the new variable
+   * @return Id of the new variable in our covariance
+   */
+  static int allocate_covariance(std::shared_ptr<State> state, int size);
+
+  /**
+   * @brief Removes all free slots from our covariance and updates the ids of our variables to match
+   * @param state Pointer to state
+   */
+  static void compact_covariance(std::shared_ptr<State> state);
+
   /**
    * All function in this class should be static.
    * Thus an instance of this class cannot be created.
@@ -43,6 +43,9 @@ struct StateOptions {
   /// Bool to determine if we should use Rk4 imu integration
   bool use_rk4_integration = true;
 
+  /// Bool to determine if we should propagate using a continuous preintegration accumulated as the imu readings arrive
+  bool use_preintegration = false;
+
   /// Bool to determine whether or not to calibrate imu-to-camera pose
   bool do_calib_camera_pose = false;
 
@@ -52,6 +55,12 @@ struct StateOptions {
   /// Bool to determine whether or not to calibrate camera to IMU time offset
   bool do_calib_camera_timeoffset = false;
 
+  /// Bool to determine whether or not to calibrate the IMU to GPS antenna lever arm
+  bool do_calib_gps_leverarm = false;
+
+  /// Bool to determine whether or not to calibrate the yaw and position of our global frame in the GPS ENU frame
+  bool do_calib_gps_frame = false;
+
   /// Max clone size of sliding window
   int max_clone_size = 11;
 
@@ -84,9 +93,12 @@ struct StateOptions {
     printf("\t- use_fej: %d\n", do_fej);
     printf("\t- use_imuavg: %d\n", imu_avg);
     printf("\t- use_rk4int: %d\n", use_rk4_integration);
+    printf("\t- use_preintegration: %d\n", use_preintegration);
     printf("\t- calib_cam_extrinsics: %d\n", do_calib_camera_pose);
     printf("\t- calib_cam_intrinsics: %d\n", do_calib_camera_intrinsics);
     printf("\t- calib_cam_timeoffset: %d\n", do_calib_camera_timeoffset);
+    printf("\t- calib_gps_leverarm: %d\n", do_calib_gps_leverarm);
+    printf("\t- calib_gps_frame: %d\n", do_calib_gps_frame);
     printf("\t- max_clones: %d\n", max_clone_size);
     printf("\t- max_slam: %d\n", max_slam_features);
     printf("\t- max_slam_in_update: %d\n", max_slam_in_update);
@@ -0,0 +1,146 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2021 Patrick Geneva
+ * Copyright (C) 2021 Guoquan Huang
+ * Copyright (C) 2021 OpenVINS Contributors
+ * Copyright (C) 2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include <Eigen/Eigen>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include "update/UpdaterHelper.h"
+#include "utils/colors.h"
+
+using namespace ov_msckf;
+
+/**
+ * Random MSCKF stacked system, where each feature is seen from all clones.
+ * Each measurement only depends on the pose of the clone it was seen from and the feature.
+ */
+struct StackedSystem {
+  std::vector<Eigen::MatrixXd> H_f;
+  std::vector<Eigen::MatrixXd> H_x;
+  std::vector<Eigen::VectorXd> res;
+};
+
+StackedSystem create_system(std::mt19937 &gen, int num_features, int num_clones) {
+  std::normal_distribution<double> w(0, 1);
+  StackedSystem sys;
+  for (int f = 0; f < num_features; f++) {
+    Eigen::MatrixXd H_f = Eigen::MatrixXd::Zero(2 * num_clones, 3);
+    Eigen::MatrixXd H_x = Eigen::MatrixXd::Zero(2 * num_clones, 6 * num_clones);
+    Eigen::VectorXd res = Eigen::VectorXd::Zero(2 * num_clones);
+    for (int c = 0; c < num_clones; c++) {
+      for (int r = 2 * c; r < 2 * c + 2; r++) {
+        for (int i = 0; i < 3; i++)
+          H_f(r, i) = w(gen);
+        for (int i = 0; i < 6; i++)
+          H_x(r, 6 * c + i) = w(gen);
+        res(r) = 1e-2 * w(gen);
+      }
+    }
+    sys.H_f.push_back(H_f);
+    sys.H_x.push_back(H_x);
+    sys.res.push_back(res);
+  }
+  return sys;
+}
+
+/**
+ * Runs the nullspace projection and compression for all features like UpdaterMSCKF::update() does.
+ * We return the information matrix and vector of the compressed system (H^T*H and H^T*r) which should be the same for both methods.
+ */
+void run_system(StackedSystem sys, int state_size, bool use_householder, double &time_null, double &time_comp, Eigen::MatrixXd &info,
+                Eigen::VectorXd &info_res) {
+
+  // Nullspace project each feature
+  boost::posix_time::ptime rT0, rT1, rT2;
+  rT0 = boost::posix_time::microsec_clock::local_time();
+  int total_rows = 0;
+  for (size_t f = 0; f < sys.H_f.size(); f++) {
+    UpdaterHelper::nullspace_project_inplace(sys.H_f.at(f), sys.H_x.at(f), sys.res.at(f), use_householder);
+    total_rows += (int)sys.res.at(f).rows();
+  }
+
+  // Stack into the big system, the clones are at the end of our state
+  rT1 = boost::posix_time::microsec_clock::local_time();
+  Eigen::MatrixXd Hx_big = Eigen::MatrixXd::Zero(total_rows, state_size);
+  Eigen::VectorXd res_big = Eigen::VectorXd::Zero(total_rows);
+  int ct_meas = 0;
+  for (size_t f = 0; f < sys.H_f.size(); f++) {
+    int rows = (int)sys.res.at(f).rows();
+    Hx_big.block(ct_meas, state_size - sys.H_x.at(f).cols(), rows, sys.H_x.at(f).cols()) = sys.H_x.at(f);
+    res_big.segment(ct_meas, rows) = sys.res.at(f);
+    ct_meas += rows;
+  }
+
+  // Finally compress
+  UpdaterHelper::measurement_compress_inplace(Hx_big, res_big, use_householder);
+  rT2 = boost::posix_time::microsec_clock::local_time();
+
+  // Return timing and information
+  time_null += (rT1 - rT0).total_microseconds() * 1e-6;
+  time_comp += (rT2 - rT1).total_microseconds() * 1e-6;
+  info = Hx_big.transpose() * Hx_big;
+  info_res = Hx_big.transpose() * res_big;
+}
+
+// Main function
+int main(int argc, char **argv) {
+
+  // Size of the problem we want to time
+  // Defaults are a large MSCKF update with 200 features all seen from 11 clones
+  int num_features = (argc > 1) ? std::atoi(argv[1]) : 200;
+  int num_clones = (argc > 2) ? std::atoi(argv[2]) : 11;
+  int num_runs = (argc > 3) ? std::atoi(argv[3]) : 20;
+  int state_size = 15 + 6 * num_clones;
+  if (num_features < 1 || num_clones < 2 || num_runs < 1) {
+    printf(RED "usage: test_qr_speed <num_features> <num_clones> <num_runs>\n" RESET);
+    return EXIT_FAILURE;
+  }
+  printf("timing %d runs of %d features seen from %d clones (state size %d)\n", num_runs, num_features, num_clones, state_size);
+
+  // Time both methods on the same systems
+  std::mt19937 gen(42);
+  double time_null_givens = 0, time_comp_givens = 0;
+  double time_null_house = 0, time_comp_house = 0;
+  double max_error = 0;
+  for (int i = 0; i < num_runs; i++) {
+    StackedSystem sys = create_system(gen, num_features, num_clones);
+    Eigen::MatrixXd info_givens, info_house;
+    Eigen::VectorXd info_res_givens, info_res_house;
+    run_system(sys, state_size, false, time_null_givens, time_comp_givens, info_givens, info_res_givens);
+    run_system(sys, state_size, true, time_null_house, time_comp_house, info_house, info_res_house);
+    max_error = std::max(max_error, (info_givens - info_house).cwiseAbs().maxCoeff() / info_givens.cwiseAbs().maxCoeff());
+    max_error = std::max(max_error, (info_res_givens - info_res_house).cwiseAbs().maxCoeff() / info_res_givens.cwiseAbs().maxCoeff());
+  }
+
+  // Print the average times
+  printf("givens: %.4f seconds nullspace, %.4f seconds compress\n", time_null_givens / num_runs, time_comp_givens / num_runs);
+  printf("householder: %.4f seconds nullspace, %.4f seconds compress\n", time_null_house / num_runs, time_comp_house / num_runs);
+  printf("speedup: %.2fx total\n", (time_null_givens + time_comp_givens) / (time_null_house + time_comp_house));
+  if (max_error > 1e-8) {
+    printf(RED "systems differ between methods (max relative error %.3e)\n" RESET, max_error);
+    return EXIT_FAILURE;
+  }
+  printf(GREEN "systems match between methods (max relative error %.3e)\n" RESET, max_error);
+  return EXIT_SUCCESS;
+}
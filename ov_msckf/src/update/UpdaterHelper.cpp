@@ -416,9 +416,31 @@ void UpdaterHelper::get_feature_jacobian_full(std::shared_ptr<State> state, Upda
   }
 }
 
-void UpdaterHelper::nullspace_project_inplace(Eigen::MatrixXd &H_f, Eigen::MatrixXd &H_x, Eigen::VectorXd &res) {
+void UpdaterHelper::nullspace_project_inplace(Eigen::MatrixXd &H_f, Eigen::MatrixXd &H_x, Eigen::VectorXd &res, bool use_householder) {
 
   // Apply the left nullspace of H_f to all variables
+  // Q^T of the QR of H_f has its left nullspace as the rows after the first H_f.cols() ones
+  // Eigen will apply the reflectors in blocks, which is much faster then the Givens for wide H_x
+  if (use_householder) {
+    Eigen::HouseholderQR<Eigen::Ref<Eigen::MatrixXd>> qr(H_f);
+    H_x.applyOnTheLeft(qr.householderQ().adjoint());
+    res.applyOnTheLeft(qr.householderQ().adjoint());
+  } else {
+    nullspace_project_givens(H_f, H_x, res);
+  }
+
+  // The H_f jacobian max rank is 3 if it is a 3d position, thus size of the left nullspace is Hf.rows()-3
+  // NOTE: need to eigen3 eval here since this experiences aliasing!
+  // H_f = H_f.block(H_f.cols(),0,H_f.rows()-H_f.cols(),H_f.cols()).eval();
+  H_x = H_x.block(H_f.cols(), 0, H_x.rows() - H_f.cols(), H_x.cols()).eval();
+  res = res.block(H_f.cols(), 0, res.rows() - H_f.cols(), res.cols()).eval();
+
+  // Sanity check
+  assert(H_x.rows() == res.rows());
+}
+
+void UpdaterHelper::nullspace_project_givens(Eigen::MatrixXd &H_f, Eigen::MatrixXd &H_x, Eigen::VectorXd &res) {
+
   // Based on "Matrix Computations 4th Edition by Golub and Van Loan"
   // See page 252, Algorithm 5.2.4 for how these two loops work
   // They use "matlab" index notation, thus we need to subtract 1 from all index
@@ -435,23 +457,37 @@ void UpdaterHelper::nullspace_project_inplace(Eigen::MatrixXd &H_f, Eigen::Matri
       (res.block(m - 1, 0, 2, 1)).applyOnTheLeft(0, 1, tempHo_GR.adjoint());
     }
   }
-
-  // The H_f jacobian max rank is 3 if it is a 3d position, thus size of the left nullspace is Hf.rows()-3
-  // NOTE: need to eigen3 eval here since this experiences aliasing!
-  // H_f = H_f.block(H_f.cols(),0,H_f.rows()-H_f.cols(),H_f.cols()).eval();
-  H_x = H_x.block(H_f.cols(), 0, H_x.rows() - H_f.cols(), H_x.cols()).eval();
-  res = res.block(H_f.cols(), 0, res.rows() - H_f.cols(), res.cols()).eval();
-
-  // Sanity check
-  assert(H_x.rows() == res.rows());
 }
 
-void UpdaterHelper::measurement_compress_inplace(Eigen::MatrixXd &H_x, Eigen::VectorXd &res) {
+void UpdaterHelper::measurement_compress_inplace(Eigen::MatrixXd &H_x, Eigen::VectorXd &res, bool use_householder) {
 
   // Return if H_x is a fat matrix (there is no need to compress in this case)
   if (H_x.rows() <= H_x.cols())
     return;
 
+  // Do measurement compression through a blocked QR of H_x
+  // The decomposition is done in place, so R is left in the upper triangular part of H_x
+  // We then only need to rotate the residual, and zero out the reflectors below R
+  if (use_householder) {
+    Eigen::HouseholderQR<Eigen::Ref<Eigen::MatrixXd>> qr(H_x);
+    res.applyOnTheLeft(qr.householderQ().adjoint());
+    H_x.triangularView<Eigen::StrictlyLower>().setZero();
+  } else {
+    measurement_compress_givens(H_x, res);
+  }
+
+  // If H is a fat matrix, then use the rows
+  // Else it should be same size as our state
+  int r = std::min(H_x.rows(), H_x.cols());
+
+  // Construct the smaller jacobian and residual after measurement compression
+  assert(r <= H_x.rows());
+  H_x.conservativeResize(r, H_x.cols());
+  res.conservativeResize(r, res.cols());
+}
+
+void UpdaterHelper::measurement_compress_givens(Eigen::MatrixXd &H_x, Eigen::VectorXd &res) {
+
   // Do measurement compression through givens rotations
   // Based on "Matrix Computations 4th Edition by Golub and Van Loan"
   // See page 252, Algorithm 5.2.4 for how these two loops work
@@ -468,13 +504,4 @@ void UpdaterHelper::measurement_compress_inplace(Eigen::MatrixXd &H_x, Eigen::Ve
       (res.block(m - 1, 0, 2, 1)).applyOnTheLeft(0, 1, tempHo_GR.adjoint());
     }
   }
-
-  // If H is a fat matrix, then use the rows
-  // Else it should be same size as our state
-  int r = std::min(H_x.rows(), H_x.cols());
-
-  // Construct the smaller jacobian and residual after measurement compression
-  assert(r <= H_x.rows());
-  H_x.conservativeResize(r, H_x.cols());
-  res.conservativeResize(r, res.cols());
 }
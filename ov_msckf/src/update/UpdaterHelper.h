@@ -55,13 +55,13 @@ public:
     size_t featid;
 
     /// UV coordinates that this feature has been seen from (mapped by camera ID)
-    std::unordered_map<size_t, std::vector<Eigen::VectorXf>> uvs;
+    ov_core::Feature::CameraUVs uvs;
 
     // UV normalized coordinates that this feature has been seen from (mapped by camera ID)
-    std::unordered_map<size_t, std::vector<Eigen::VectorXf>> uvs_norm;
+    ov_core::Feature::CameraUVs uvs_norm;
 
     /// Timestamps of each UV measurement (mapped by camera ID)
-    std::unordered_map<size_t, std::vector<double>> timestamps;
+    ov_core::Feature::CameraTimes timestamps;
 
     /// What representation our feature is in
     LandmarkRepresentation::Representation feat_representation;
@@ -117,22 +117,37 @@ public:
    * This is the MSCKF nullspace projection which removes the dependency on the feature state.
    * Note that this is done **in place** so all matrices will be different after a function call.
    *
+   * By default this applies Givens rotations one row pair at a time.
+   * Instead we can use a Householder QR of H_f which applies its reflectors to H_x in blocks.
+   * Both give an orthonormal basis of the left nullspace, but not the same one, so the projected system will differ by a rotation.
+   * This does not change the resulting update since our measurement noise is isotropic.
+   *
    * @param H_f Jacobian with nullspace we want to project onto the system [res = Hx*(x-xhat)+Hf(f-fhat)+n]
    * @param H_x State jacobian
    * @param res Measurement residual
+   * @param use_householder If we should use Householder QR instead of Givens rotations
    */
-  static void nullspace_project_inplace(Eigen::MatrixXd &H_f, Eigen::MatrixXd &H_x, Eigen::VectorXd &res);
+  static void nullspace_project_inplace(Eigen::MatrixXd &H_f, Eigen::MatrixXd &H_x, Eigen::VectorXd &res, bool use_householder = false);
 
   /**
    * @brief This will perform measurement compression
    *
    * Please see the @ref update-compress for details on how this works.
    * Note that this is done **in place** so all matrices will be different after a function call.
+   * The Householder QR is blocked, and is much faster for large stacked systems (e.g. a large max_msckf_in_update).
    *
    * @param H_x State jacobian
    * @param res Measurement residual
+   * @param use_householder If we should use Householder QR instead of Givens rotations
    */
-  static void measurement_compress_inplace(Eigen::MatrixXd &H_x, Eigen::VectorXd &res);
+  static void measurement_compress_inplace(Eigen::MatrixXd &H_x, Eigen::VectorXd &res, bool use_householder = false);
+
+protected:
+  /// Rotates the system with Givens rotations such that H_f becomes upper triangular
+  static void nullspace_project_givens(Eigen::MatrixXd &H_f, Eigen::MatrixXd &H_x, Eigen::VectorXd &res);
+
+  /// Rotates the system with Givens rotations such that H_x becomes upper triangular
+  static void measurement_compress_givens(Eigen::MatrixXd &H_x, Eigen::VectorXd &res);
 };
 
 } // namespace ov_msckf
@@ -85,26 +85,35 @@ void UpdaterMSCKF::update(std::shared_ptr<State> state, std::vector<std::shared_
   }
 
   // 3. Try to triangulate all MSCKF or new SLAM features that have measurements
+  // Each feature is independent of the others, so we can do this in parallel
+  // NOTE: we record if each was a success and remove them afterwards so the feature order is unchanged
+  std::vector<char> success(feature_vec.size(), 0);
+  parallel_for_(cv::Range(0, (int)feature_vec.size()), LambdaBody([&](const cv::Range &range) {
+                  for (int i = range.start; i < range.end; i++) {
+
+                    // Triangulate the feature
+                    // 三角化
+                    bool success_tri = true;
+                    if (initializer_feat->config().triangulate_1d) {
+                      success_tri = initializer_feat->single_triangulation_1d(feature_vec.at(i).get(), clones_cam);
+                    } else {
+                      success_tri = initializer_feat->single_triangulation(feature_vec.at(i).get(), clones_cam);
+                    }
+
+                    // Gauss-newton refine the feature
+                    bool success_refine = true;
+                    if (success_tri && initializer_feat->config().refine_features) {
+                      success_refine = initializer_feat->single_gaussnewton(feature_vec.at(i).get(), clones_cam);
+                    }
+                    success.at(i) = (char)(success_tri && success_refine);
+                  }
+                }));
+
+  // Remove the features that were not a success
+  size_t ct_feat = 0;
   auto it1 = feature_vec.begin();
   while (it1 != feature_vec.end()) {
-
-    // Triangulate the feature and remove if it fails
-    // 三角化
-    bool success_tri = true;
-    if (initializer_feat->config().triangulate_1d) {
-      success_tri = initializer_feat->single_triangulation_1d(it1->get(), clones_cam);
-    } else {
-      success_tri = initializer_feat->single_triangulation(it1->get(), clones_cam);
-    }
-
-    // Gauss-newton refine the feature
-    bool success_refine = true;
-    if (initializer_feat->config().refine_features) {
-      success_refine = initializer_feat->single_gaussnewton(it1->get(), clones_cam);
-    }
-
-    // Remove the feature if not a success
-    if (!success_tri || !success_refine) {
+    if (!success.at(ct_feat++)) {
       (*it1)->to_delete = true;
       it1 = feature_vec.erase(it1);
       continue;
@@ -137,76 +146,32 @@ void UpdaterMSCKF::update(std::shared_ptr<State> state, std::vector<std::shared_
   size_t ct_meas = 0;
 
   // 4. Compute linear system for each feature, nullspace project, and reject
+  // The system of each feature only depends on the state, so these are computed in parallel
+  // Afterwards we append them in the order of our features so the result does not depend on the number of threads
+  std::vector<FeatureSystem> systems(feature_vec.size());
+  parallel_for_(cv::Range(0, (int)feature_vec.size()), LambdaBody([&](const cv::Range &range) {
+                  for (int i = range.start; i < range.end; i++) {
+                    systems.at(i) = compute_feature_system(state, feature_vec.at(i));
+                  }
+                }));
+
+  // Append all good features to our large H vector
+  // 遍历所有特征点，得到最终的Hx和res
+  ct_feat = 0;
   auto it2 = feature_vec.begin();
   while (it2 != feature_vec.end()) {
 
-    // Convert our feature into our current format
-    UpdaterHelper::UpdaterHelperFeature feat;
-    feat.featid = (*it2)->featid;
-    feat.uvs = (*it2)->uvs;
-    feat.uvs_norm = (*it2)->uvs_norm;
-    feat.timestamps = (*it2)->timestamps;
-
-    // If we are using single inverse depth, then it is equivalent to using the msckf inverse depth
-    feat.feat_representation = state->_options.feat_rep_msckf;
-    if (state->_options.feat_rep_msckf == LandmarkRepresentation::Representation::ANCHORED_INVERSE_DEPTH_SINGLE) {
-      feat.feat_representation = LandmarkRepresentation::Representation::ANCHORED_MSCKF_INVERSE_DEPTH;
-    }
-
-    // Save the position and its fej value
-    if (LandmarkRepresentation::is_relative_representation(feat.feat_representation)) {
-      feat.anchor_cam_id = (*it2)->anchor_cam_id;
-      feat.anchor_clone_timestamp = (*it2)->anchor_clone_timestamp;
-      feat.p_FinA = (*it2)->p_FinA;
-      feat.p_FinA_fej = (*it2)->p_FinA;
-    } else {
-      feat.p_FinG = (*it2)->p_FinG;
-      feat.p_FinG_fej = (*it2)->p_FinG;
-    }
-
-    // Our return values (feature jacobian, state jacobian, residual, and order of state jacobian)
-    Eigen::MatrixXd H_f;
-    Eigen::MatrixXd H_x;
-    Eigen::VectorXd res;
-    std::vector<std::shared_ptr<Type>> Hx_order;
-
-    // Get the Jacobian for this feature
-    // 获取特征点的Jacobian
-    UpdaterHelper::get_feature_jacobian_full(state, feat, H_f, H_x, res, Hx_order);
-
-    // Nullspace project
-    UpdaterHelper::nullspace_project_inplace(H_f, H_x, res);
-
-    /// Chi2 distance check
-    Eigen::MatrixXd P_marg = StateHelper::get_marginal_covariance(state, Hx_order);
-    Eigen::MatrixXd S = H_x * P_marg * H_x.transpose();
-    S.diagonal() += _options.sigma_pix_sq * Eigen::VectorXd::Ones(S.rows());
-    double chi2 = res.dot(S.llt().solve(res));
-
-    // Get our threshold (we precompute up to 500 but handle the case that it is more)
-    double chi2_check;
-    if (res.rows() < 500) {
-      chi2_check = chi_squared_table[res.rows()];
-    } else {
-      boost::math::chi_squared chi_squared_dist(res.rows());
-      chi2_check = boost::math::quantile(chi_squared_dist, 0.95);
-      printf(YELLOW "chi2_check over the residual limit - %d\n" RESET, (int)res.rows());
-    }
-
     // Check if we should delete or not
-    if (chi2 > _options.chi2_multipler * chi2_check) {
+    FeatureSystem &system = systems.at(ct_feat++);
+    if (!system.valid) {
       (*it2)->to_delete = true;
       it2 = feature_vec.erase(it2);
-      // cout << "featid = " << feat.featid << endl;
-      // cout << "chi2 = " << chi2 << " > " << _options.chi2_multipler*chi2_check << endl;
-      // cout << "res = " << endl << res.transpose() << endl;
       continue;
     }
 
     // We are good!!! Append to our large H vector
-    // 遍历所有特征点，得到最终的Hx和res
     size_t ct_hx = 0;
-    for (const auto &var : Hx_order) {
+    for (const auto &var : system.Hx_order) {
 
       // Ensure that this variable is in our Jacobian
       if (Hx_mapping.find(var) == Hx_mapping.end()) {
@@ -216,13 +181,13 @@ void UpdaterMSCKF::update(std::shared_ptr<State> state, std::vector<std::shared_
       }
 
       // Append to our large Jacobian
-      Hx_big.block(ct_meas, Hx_mapping[var], H_x.rows(), var->size()) = H_x.block(0, ct_hx, H_x.rows(), var->size());
+      Hx_big.block(ct_meas, Hx_mapping[var], system.H_x.rows(), var->size()) = system.H_x.block(0, ct_hx, system.H_x.rows(), var->size());
       ct_hx += var->size();
     }
 
     // Append our residual and move forward
-    res_big.block(ct_meas, 0, res.rows(), 1) = res;
-    ct_meas += res.rows();
+    res_big.block(ct_meas, 0, system.res.rows(), 1) = system.res;
+    ct_meas += system.res.rows();
     it2++;
   }
   rT3 = boost::posix_time::microsec_clock::local_time();
@@ -244,7 +209,7 @@ void UpdaterMSCKF::update(std::shared_ptr<State> state, std::vector<std::shared_
 
   // 5. Perform measurement compression
   // QR分解压缩矩阵
-  UpdaterHelper::measurement_compress_inplace(Hx_big, res_big);
+  UpdaterHelper::measurement_compress_inplace(Hx_big, res_big, _options.use_householder_qr);
   if (Hx_big.rows() < 1) {
     return;
   }
@@ -265,3 +230,59 @@ void UpdaterMSCKF::update(std::shared_ptr<State> state, std::vector<std::shared_
   // printf("[MSCKF-UP]: %.4f seconds update state (%d size)\n",(rT5-rT4).total_microseconds() * 1e-6, (int)res_big.rows());
   // printf("[MSCKF-UP]: %.4f seconds total\n",(rT5-rT1).total_microseconds() * 1e-6);
 }
+
+UpdaterMSCKF::FeatureSystem UpdaterMSCKF::compute_feature_system(std::shared_ptr<State> state, const std::shared_ptr<Feature> &feature) {
+
+  // Convert our feature into our current format
+  UpdaterHelper::UpdaterHelperFeature feat;
+  feat.featid = feature->featid;
+  feat.uvs = feature->uvs;
+  feat.uvs_norm = feature->uvs_norm;
+  feat.timestamps = feature->timestamps;
+
+  // If we are using single inverse depth, then it is equivalent to using the msckf inverse depth
+  feat.feat_representation = state->_options.feat_rep_msckf;
+  if (state->_options.feat_rep_msckf == LandmarkRepresentation::Representation::ANCHORED_INVERSE_DEPTH_SINGLE) {
+    feat.feat_representation = LandmarkRepresentation::Representation::ANCHORED_MSCKF_INVERSE_DEPTH;
+  }
+
+  // Save the position and its fej value
+  if (LandmarkRepresentation::is_relative_representation(feat.feat_representation)) {
+    feat.anchor_cam_id = feature->anchor_cam_id;
+    feat.anchor_clone_timestamp = feature->anchor_clone_timestamp;
+    feat.p_FinA = feature->p_FinA;
+    feat.p_FinA_fej = feature->p_FinA;
+  } else {
+    feat.p_FinG = feature->p_FinG;
+    feat.p_FinG_fej = feature->p_FinG;
+  }
+
+  // Our return values (feature jacobian, state jacobian, residual, and order of state jacobian)
+  FeatureSystem system;
+  Eigen::MatrixXd H_f;
+
+  // Get the Jacobian for this feature
+  // 获取特征点的Jacobian
+  UpdaterHelper::get_feature_jacobian_full(state, feat, H_f, system.H_x, system.res, system.Hx_order);
+
+  // Nullspace project
+  UpdaterHelper::nullspace_project_inplace(H_f, system.H_x, system.res, _options.use_householder_qr);
+
+  /// Chi2 distance check
+  Eigen::MatrixXd P_marg = StateHelper::get_marginal_covariance(state, system.Hx_order);
+  Eigen::MatrixXd S = system.H_x * P_marg * system.H_x.transpose();
+  S.diagonal() += _options.sigma_pix_sq * Eigen::VectorXd::Ones(S.rows());
+  double chi2 = system.res.dot(S.llt().solve(system.res));
+
+  // Get our threshold
+  double chi2_check = chi_squared_table->quantile((int)system.res.rows());
+
+  // Check if we should delete or not
+  system.valid = (chi2 <= _options.chi2_multipler * chi2_check);
+  // if (!system.valid) {
+  //   cout << "featid = " << feat.featid << endl;
+  //   cout << "chi2 = " << chi2 << " > " << _options.chi2_multipler*chi2_check << endl;
+  //   cout << "res = " << endl << res.transpose() << endl;
+  // }
+  return system;
+}
@@ -28,7 +28,9 @@
 #include "state/State.h"
 #include "state/StateHelper.h"
 #include "types/LandmarkRepresentation.h"
+#include "utils/chi_squared_table.h"
 #include "utils/colors.h"
+#include "utils/lambda_body.h"
 #include "utils/quat_ops.h"
 #include <Eigen/Eigen>
 
@@ -36,7 +38,6 @@
 #include "UpdaterOptions.h"
 
 #include <boost/date_time/posix_time/posix_time.hpp>
-#include <boost/math/distributions/chi_squared.hpp>
 
 namespace ov_msckf {
 
@@ -67,12 +68,8 @@ public:
     // Save our feature initializer
     initializer_feat = std::unique_ptr<FeatureInitializer>(new FeatureInitializer(feat_init_options));
 
-    // Initialize the chi squared test table with confidence level 0.95
-    // https://github.com/KumarRobotics/msckf_vio/blob/050c50defa5a7fd9a04c1eed5687b405f02919b5/src/msckf_vio.cpp#L215-L221
-    for (int i = 1; i < 500; i++) {
-      boost::math::chi_squared chi_squared_dist(i);
-      chi_squared_table[i] = boost::math::quantile(chi_squared_dist, 0.95);
-    }
+    // Get the shared chi squared test table for our confidence level
+    chi_squared_table = ChiSquaredTable::get(_options.chi2_confidence);
   }
 
   /**
@@ -84,14 +81,43 @@ public:
   void update(std::shared_ptr<State> state, std::vector<std::shared_ptr<Feature>> &feature_vec);
 
 protected:
+  /**
+   * @brief Nullspace projected linear system of a single feature
+   */
+  struct FeatureSystem {
+
+    /// If this feature passed the chi2 test and should be used in the update
+    bool valid = false;
+
+    /// Nullspace projected state Jacobian
+    Eigen::MatrixXd H_x;
+
+    /// Nullspace projected residual
+    Eigen::VectorXd res;
+
+    /// Variables our Jacobian is in respect to
+    std::vector<std::shared_ptr<Type>> Hx_order;
+  };
+
+  /**
+   * @brief Computes the nullspace projected system of a triangulated feature and checks it with a chi2 test.
+   *
+   * This only reads from the state and feature, thus it can be called for different features in parallel.
+   *
+   * @param state State of the filter
+   * @param feature Triangulated feature we want the system of
+   * @return Linear system of this feature
+   */
+  FeatureSystem compute_feature_system(std::shared_ptr<State> state, const std::shared_ptr<Feature> &feature);
+
   /// Options used during update
   UpdaterOptions _options;
 
   /// Feature initializer class object
   std::unique_ptr<FeatureInitializer> initializer_feat;
 
-  /// Chi squared 95th percentile table (lookup would be size of residual)
-  std::map<int, double> chi_squared_table;
+  /// Chi squared quantile table (lookup would be size of residual)
+  std::shared_ptr<ChiSquaredTable> chi_squared_table;
 };
 
 } // namespace ov_msckf
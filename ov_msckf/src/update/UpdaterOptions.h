@@ -32,16 +32,24 @@ struct UpdaterOptions {
   /// What chi-squared multipler we should apply
   double chi2_multipler = 5;
 
+  /// Confidence level of the chi-squared quantile our multipler is applied to
+  double chi2_confidence = 0.95;
+
   /// Noise sigma for our raw pixel measurements
   double sigma_pix = 1;
 
   /// Covariance for our raw pixel measurements
   double sigma_pix_sq = 1;
 
+  /// If we should use a blocked Householder QR instead of Givens rotations for nullspace projection and compression
+  bool use_householder_qr = false;
+
   /// Nice print function of what parameters we have loaded
   void print() {
     printf("\t- chi2_multipler: %.1f\n", chi2_multipler);
+    printf("\t- chi2_confidence: %.3f\n", chi2_confidence);
     printf("\t- sigma_pix: %.2f\n", sigma_pix);
+    printf("\t- use_householder_qr: %d\n", use_householder_qr);
   }
 };
 
@@ -166,7 +166,9 @@ void UpdaterSLAM::delayed_init(std::shared_ptr<State> state, std::vector<std::sh
       // Nullspace project the bearing portion
       // This takes into account that we have marginalized the bearing already
       // Thus this is crucial to ensuring estimator consistency as we are not taking the bearing to be true
-      UpdaterHelper::nullspace_project_inplace(H_f, H_xf, res);
+      bool use_householder =
+          ((int)feat.featid < state->_options.max_aruco_features) ? _options_aruco.use_householder_qr : _options_slam.use_householder_qr;
+      UpdaterHelper::nullspace_project_inplace(H_f, H_xf, res, use_householder);
 
       // Split out the state portion and feature portion
       H_x = H_xf.block(0, 0, H_xf.rows(), H_xf.cols() - 1);
@@ -198,7 +200,9 @@ void UpdaterSLAM::delayed_init(std::shared_ptr<State> state, std::vector<std::sh
     // Try to initialize, delete new pointer if we failed
     double chi2_multipler =
         ((int)feat.featid < state->_options.max_aruco_features) ? _options_aruco.chi2_multipler : _options_slam.chi2_multipler;
-    if (StateHelper::initialize(state, landmark, Hx_order, H_x, H_f, R, res, chi2_multipler)) {
+    std::shared_ptr<ChiSquaredTable> &chi_squared_table =
+        ((int)feat.featid < state->_options.max_aruco_features) ? chi_squared_table_aruco : chi_squared_table_slam;
+    if (StateHelper::initialize(state, landmark, Hx_order, H_x, H_f, R, res, chi2_multipler, chi_squared_table)) {
       state->_features_SLAM.insert({(*it2)->featid, landmark});
       (*it2)->to_delete = true;
       it2++;
@@ -341,7 +345,9 @@ void UpdaterSLAM::update(std::shared_ptr<State> state, std::vector<std::shared_p
       // Nullspace project the bearing portion
       // This takes into account that we have marginalized the bearing already
       // Thus this is crucial to ensuring estimator consistency as we are not taking the bearing to be true
-      UpdaterHelper::nullspace_project_inplace(H_f, H_xf, res);
+      bool use_householder =
+          ((int)feat.featid < state->_options.max_aruco_features) ? _options_aruco.use_householder_qr : _options_slam.use_householder_qr;
+      UpdaterHelper::nullspace_project_inplace(H_f, H_xf, res, use_householder);
 
     } else {
 
@@ -362,15 +368,10 @@ void UpdaterSLAM::update(std::shared_ptr<State> state, std::vector<std::shared_p
     S.diagonal() += sigma_pix_sq * Eigen::VectorXd::Ones(S.rows());
     double chi2 = res.dot(S.llt().solve(res));
 
-    // Get our threshold (we precompute up to 500 but handle the case that it is more)
-    double chi2_check;
-    if (res.rows() < 500) {
-      chi2_check = chi_squared_table[res.rows()];
-    } else {
-      boost::math::chi_squared chi_squared_dist(res.rows());
-      chi2_check = boost::math::quantile(chi_squared_dist, 0.95);
-      printf(YELLOW "chi2_check over the residual limit - %d\n" RESET, (int)res.rows());
-    }
+    // Get our threshold
+    std::shared_ptr<ChiSquaredTable> &chi_squared_table =
+        ((int)feat.featid < state->_options.max_aruco_features) ? chi_squared_table_aruco : chi_squared_table_slam;
+    double chi2_check = chi_squared_table->quantile((int)res.rows());
 
     // Check if we should delete or not
     double chi2_multipler =
@@ -29,6 +29,7 @@
 #include "state/StateHelper.h"
 #include "types/Landmark.h"
 #include "types/LandmarkRepresentation.h"
+#include "utils/chi_squared_table.h"
 #include "utils/colors.h"
 #include "utils/quat_ops.h"
 #include <Eigen/Eigen>
@@ -37,7 +38,6 @@
 #include "UpdaterOptions.h"
 
 #include <boost/date_time/posix_time/posix_time.hpp>
-#include <boost/math/distributions/chi_squared.hpp>
 
 namespace ov_msckf {
 
@@ -70,12 +70,9 @@ public:
     // Save our feature initializer
     initializer_feat = std::unique_ptr<FeatureInitializer>(new FeatureInitializer(feat_init_options));
 
-    // Initialize the chi squared test table with confidence level 0.95
-    // https://github.com/KumarRobotics/msckf_vio/blob/050c50defa5a7fd9a04c1eed5687b405f02919b5/src/msckf_vio.cpp#L215-L221
-    for (int i = 1; i < 500; i++) {
-      boost::math::chi_squared chi_squared_dist(i);
-      chi_squared_table[i] = boost::math::quantile(chi_squared_dist, 0.95);
-    }
+    // Get the shared chi squared test tables for our confidence levels
+    chi_squared_table_slam = ChiSquaredTable::get(_options_slam.chi2_confidence);
+    chi_squared_table_aruco = ChiSquaredTable::get(_options_aruco.chi2_confidence);
   }
 
   /**
@@ -122,8 +119,9 @@ protected:
   /// Feature initializer class object
   std::unique_ptr<FeatureInitializer> initializer_feat;
 
-  /// Chi squared 95th percentile table (lookup would be size of residual)
-  std::map<int, double> chi_squared_table;
+  /// Chi squared quantile tables for SLAM and ARUCO features (lookup would be size of residual)
+  std::shared_ptr<ChiSquaredTable> chi_squared_table_slam;
+  std::shared_ptr<ChiSquaredTable> chi_squared_table_aruco;
 };
 
 } // namespace ov_msckf
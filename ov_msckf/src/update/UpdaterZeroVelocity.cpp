@@ -26,7 +26,8 @@ using namespace ov_msckf;
 bool UpdaterZeroVelocity::try_update(std::shared_ptr<State> state, double timestamp) {
 
   // Return if we don't have any imu data yet
-  if (imu_data.empty()) {
+  // NOTE: we use the inertial readings that have been fed into our propagator
+  if (_prop->get_imu_buffer()->empty()) {
     last_zupt_state_timestamp = 0.0;
     return false;
   }
@@ -55,7 +56,7 @@ bool UpdaterZeroVelocity::try_update(std::shared_ptr<State> state, double timest
   double time1 = timestamp + t_off_new;
 
   // Select bounding inertial measurements
-  std::vector<ov_core::ImuData> imu_recent = Propagator::select_imu_readings(imu_data, time0, time1);
+  std::vector<ov_core::ImuData> imu_recent = Propagator::select_imu_readings(_prop->get_imu_buffer(), time0, time1);
 
   // Move forward in time
   last_prop_time_offset = t_off_new;
@@ -152,15 +153,8 @@ bool UpdaterZeroVelocity::try_update(std::shared_ptr<State> state, double timest
   Eigen::MatrixXd S = H * P_marg * H.transpose() + R;
   double chi2 = res.dot(S.llt().solve(res));
 
-  // Get our threshold (we precompute up to 1000 but handle the case that it is more)
-  double chi2_check;
-  if (res.rows() < 1000) {
-    chi2_check = chi_squared_table[res.rows()];
-  } else {
-    boost::math::chi_squared chi_squared_dist(res.rows());
-    chi2_check = boost::math::quantile(chi_squared_dist, 0.95);
-    printf(YELLOW "[ZUPT]: chi2_check over the residual limit - %d\n" RESET, (int)res.rows());
-  }
+  // Get our threshold
+  double chi2_check = chi_squared_table->quantile((int)res.rows());
 
   // Check if the image disparity
   bool disparity_passed = false;
@@ -243,6 +237,14 @@ bool UpdaterZeroVelocity::try_update(std::shared_ptr<State> state, double timest
       StateHelper::EKFPropagation(state, Phi_order, Phi_order, Phi_bias, Q_bias);
     }
 
+    // Our noise is diagonal, thus we can whiten our system so it is isotropic and then compress it
+    // This does not change the update, but we now only have as many rows as our state instead of 6 per reading
+    Eigen::VectorXd R_sqrt_inv = R.diagonal().cwiseSqrt().cwiseInverse();
+    H = R_sqrt_inv.asDiagonal() * H;
+    res = res.cwiseProduct(R_sqrt_inv);
+    UpdaterHelper::measurement_compress_inplace(H, res, _options.use_householder_qr);
+    R = Eigen::MatrixXd::Identity(res.rows(), res.rows());
+
     // Finally move the state time forward
     StateHelper::EKFUpdate(state, Hx_order, H, res, R);
     state->_timestamp = timestamp;
@@ -26,6 +26,7 @@
 #include "state/Propagator.h"
 #include "state/State.h"
 #include "state/StateHelper.h"
+#include "utils/chi_squared_table.h"
 #include "utils/colors.h"
 #include "utils/quat_ops.h"
 #include "utils/sensor_data.h"
@@ -34,7 +35,6 @@
 #include "UpdaterOptions.h"
 
 #include <boost/date_time/posix_time/posix_time.hpp>
-#include <boost/math/distributions/chi_squared.hpp>
 
 namespace ov_msckf {
 
@@ -55,7 +55,7 @@ public:
    * @param options Updater options (chi2 multiplier)
    * @param noises imu noise characteristics (continuous time)
    * @param db Feature tracker database with all features in it
-   * @param prop Propagator class object which can predict the state forward in time
+   * @param prop Propagator class object which can predict the state forward in time (we also use its inertial readings)
    * @param gravity_mag Global gravity magnitude of the system (normally 9.81)
    * @param zupt_max_velocity Max velocity we should consider to do a update with
    * @param zupt_noise_multiplier Multiplier of our IMU noise matrix (default should be 1.0)
@@ -76,39 +76,8 @@ public:
     _noises.sigma_wb_2 = std::pow(_noises.sigma_wb, 2);
     _noises.sigma_ab_2 = std::pow(_noises.sigma_ab, 2);
 
-    // Initialize the chi squared test table with confidence level 0.95
-    // https://github.com/KumarRobotics/msckf_vio/blob/050c50defa5a7fd9a04c1eed5687b405f02919b5/src/msckf_vio.cpp#L215-L221
-    for (int i = 1; i < 1000; i++) {
-      boost::math::chi_squared chi_squared_dist(i);
-      chi_squared_table[i] = boost::math::quantile(chi_squared_dist, 0.95);
-    }
-  }
-
-  /**
-   * @brief Feed function for inertial data
-   * @param message Contains our timestamp and inertial information
-   */
-  void feed_imu(const ov_core::ImuData &message) {
-
-    // Append it to our vector
-    imu_data.emplace_back(message);
-
-    // Sort our imu data (handles any out of order measurements)
-    // std::sort(imu_data.begin(), imu_data.end(), [](const IMUDATA i, const IMUDATA j) {
-    //    return i.timestamp < j.timestamp;
-    //});
-
-    // Loop through and delete imu messages that are older then 10 seconds
-    // TODO: we should probably have more elegant logic then this
-    // TODO: but this prevents unbounded memory growth and slow prop with high freq imu
-    auto it0 = imu_data.begin();
-    while (it0 != imu_data.end()) {
-      if (message.timestamp - (*it0).timestamp > 10) {
-        it0 = imu_data.erase(it0);
-      } else {
-        it0++;
-      }
-    }
+    // Get the shared chi squared test table for our confidence level
+    chi_squared_table = ChiSquaredTable::get(_options.chi2_confidence);
   }
 
   /**
@@ -144,11 +113,8 @@ protected:
   /// Max disparity (pixels) that we should consider a zupt with
   double _zupt_max_disparity = 1.0;
 
-  /// Chi squared 95th percentile table (lookup would be size of residual)
-  std::map<int, double> chi_squared_table;
-
-  /// Our history of IMU messages (time, angular, linear)
-  std::vector<ov_core::ImuData> imu_data;
+  /// Chi squared quantile table (lookup would be size of residual)
+  std::shared_ptr<ChiSquaredTable> chi_squared_table;
 
   /// Estimate for time offset at last propagation time
   double last_prop_time_offset = 0.0;
@@ -50,9 +50,12 @@ VioManagerOptions parse_command_line_arguments(int argc, char **argv) {
   app1.add_option("--use_fej", params.state_options.do_fej, "");
   app1.add_option("--use_imuavg", params.state_options.imu_avg, "");
   app1.add_option("--use_rk4int", params.state_options.use_rk4_integration, "");
+  app1.add_option("--use_preintegration", params.state_options.use_preintegration, "");
   app1.add_option("--calib_cam_extrinsics", params.state_options.do_calib_camera_pose, "");
   app1.add_option("--calib_cam_intrinsics", params.state_options.do_calib_camera_intrinsics, "");
   app1.add_option("--calib_cam_timeoffset", params.state_options.do_calib_camera_timeoffset, "");
+  app1.add_option("--calib_gps_leverarm", params.state_options.do_calib_gps_leverarm, "");
+  app1.add_option("--calib_gps_frame", params.state_options.do_calib_gps_frame, "");
   app1.add_option("--max_clones", params.state_options.max_clone_size, "");
   app1.add_option("--max_slam", params.state_options.max_slam_features, "");
   app1.add_option("--max_slam_in_update", params.state_options.max_slam_in_update, "");
@@ -81,9 +84,23 @@ VioManagerOptions parse_command_line_arguments(int argc, char **argv) {
   app1.add_option("--zupt_max_disparity", params.zupt_max_disparity, "");
   app1.add_option("--zupt_only_at_beginning", params.zupt_only_at_beginning, "");
 
+  // GPS update
+  app1.add_option("--gps_use_clones", params.gps_use_clones, "");
+  app1.add_option("--gps_clone_max_dt", params.gps_clone_max_dt, "");
+  app1.add_option("--gps_sigma_min", params.gps_sigma_min, "");
+  app1.add_option("--gps_sigma_unknown", params.gps_sigma_unknown, "");
+
   // Recording of timing information to file
   app1.add_option("--record_timing_information", params.record_timing_information, "");
   app1.add_option("--record_timing_filepath", params.record_timing_filepath, "");
+  app1.add_option("--log_directory", params.log_directory, "");
+  app1.add_option("--log_max_file_mb", params.log_max_file_mb, "");
+  app1.add_option("--log_max_files", params.log_max_files, "");
+
+  // Published paths
+  app1.add_option("--path_max_length", params.path_max_length, "");
+  app1.add_option("--path_min_distance", params.path_min_distance, "");
+  app1.add_option("--path_min_dt", params.path_min_dt, "");
 
   // NOISE ======================================================================
 
@@ -100,12 +117,20 @@ VioManagerOptions parse_command_line_arguments(int argc, char **argv) {
   app1.add_option("--up_slam_chi2_multipler", params.slam_options.chi2_multipler, "");
   app1.add_option("--up_aruco_sigma_px", params.aruco_options.sigma_pix, "");
   app1.add_option("--up_aruco_chi2_multipler", params.aruco_options.chi2_multipler, "");
+  app1.add_option("--up_householder_qr", params.msckf_options.use_householder_qr, "");
+  app1.add_option("--up_gps_chi2_multipler", params.gps_options.chi2_multipler, "");
+  app1.add_option("--up_chi2_confidence", params.msckf_options.chi2_confidence, "");
 
   // STATE ======================================================================
 
   // Timeoffset from camera to IMU
   app1.add_option("--calib_camimu_dt", params.calib_camimu_dt, "");
 
+  // GPS lever arm and the yaw of our global frame in the GPS ENU frame
+  std::vector<double> p_gps_leverarm = {0, 0, 0};
+  app1.add_option("--gps_leverarm", p_gps_leverarm, "");
+  app1.add_option("--gps_yaw_GtoENU", params.gps_yaw_GtoENU, "");
+
   // Global gravity
   app1.add_option("--gravity_mag", params.gravity_mag, "");
 
@@ -118,6 +143,12 @@ VioManagerOptions parse_command_line_arguments(int argc, char **argv) {
   app1.add_option("--downsize_aruco", params.downsize_aruco, "");
   app1.add_option("--downsample_cameras", params.downsample_cameras, "");
   app1.add_option("--multi_threading", params.use_multi_threading, "");
+  app1.add_option("--undistort_table", params.use_undistort_table, "");
+  app1.add_option("--klt_prediction", params.use_klt_prediction, "");
+  app1.add_option("--klt_pred_pyr_levels", params.klt_pred_pyr_levels, "");
+  app1.add_option("--klt_pred_max_iters", params.klt_pred_max_iters, "");
+  app1.add_option("--async_tracking", params.use_async_tracking, "");
+  app1.add_option("--async_tracking_queue_size", params.async_tracking_queue_size, "");
 
   // General parameters
   app1.add_option("--num_pts", params.num_pts, "");
@@ -131,6 +162,10 @@ VioManagerOptions parse_command_line_arguments(int argc, char **argv) {
   std::string histogram_method_str = "HISTOGRAM";
   app1.add_option("--histogram_method", histogram_method_str, "");
 
+  // What to do if the estimator falls behind the tracking thread
+  std::string async_tracking_policy_str = "BLOCK";
+  app1.add_option("--async_tracking_policy", async_tracking_policy_str, "");
+
   // Feature initializer parameters
   app1.add_option("--fi_triangulate_1d", params.featinit_options.triangulate_1d, "");
   app1.add_option("--fi_refine_features", params.featinit_options.refine_features, "");
@@ -170,6 +205,19 @@ VioManagerOptions parse_command_line_arguments(int argc, char **argv) {
     std::exit(app1.exit(e));
   }
 
+  // All updaters use the same QR method and chi2 confidence level
+  params.slam_options.use_householder_qr = params.msckf_options.use_householder_qr;
+  params.aruco_options.use_householder_qr = params.msckf_options.use_householder_qr;
+  params.zupt_options.use_householder_qr = params.msckf_options.use_householder_qr;
+  params.slam_options.chi2_confidence = params.msckf_options.chi2_confidence;
+  params.aruco_options.chi2_confidence = params.msckf_options.chi2_confidence;
+  params.zupt_options.chi2_confidence = params.msckf_options.chi2_confidence;
+  params.gps_options.chi2_confidence = params.msckf_options.chi2_confidence;
+
+  // Load our GPS lever arm
+  assert(p_gps_leverarm.size() == 3);
+  params.gps_leverarm << p_gps_leverarm.at(0), p_gps_leverarm.at(1), p_gps_leverarm.at(2);
+
   // Set what representation we should be using
   std::transform(feat_rep_msckf_str.begin(), feat_rep_msckf_str.end(), feat_rep_msckf_str.begin(), ::toupper);
   std::transform(feat_rep_slam_str.begin(), feat_rep_slam_str.end(), feat_rep_slam_str.begin(), ::toupper);
@@ -212,6 +260,9 @@ VioManagerOptions parse_command_line_arguments(int argc, char **argv) {
     std::exit(EXIT_FAILURE);
   }
 
+  // Asynchronous tracking policy
+  params.load_async_tracking_policy(async_tracking_policy_str);
+
   //====================================================================================
   //====================================================================================
   //====================================================================================
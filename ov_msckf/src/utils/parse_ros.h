@@ -46,9 +46,12 @@ VioManagerOptions parse_ros_nodehandler(ros::NodeHandle &nh) {
   nh.param<bool>("use_fej", params.state_options.do_fej, params.state_options.do_fej);
   nh.param<bool>("use_imuavg", params.state_options.imu_avg, params.state_options.imu_avg);
   nh.param<bool>("use_rk4int", params.state_options.use_rk4_integration, params.state_options.use_rk4_integration);
+  nh.param<bool>("use_preintegration", params.state_options.use_preintegration, params.state_options.use_preintegration);
   nh.param<bool>("calib_cam_extrinsics", params.state_options.do_calib_camera_pose, params.state_options.do_calib_camera_pose);
   nh.param<bool>("calib_cam_intrinsics", params.state_options.do_calib_camera_intrinsics, params.state_options.do_calib_camera_intrinsics);
   nh.param<bool>("calib_cam_timeoffset", params.state_options.do_calib_camera_timeoffset, params.state_options.do_calib_camera_timeoffset);
+  nh.param<bool>("calib_gps_leverarm", params.state_options.do_calib_gps_leverarm, params.state_options.do_calib_gps_leverarm);
+  nh.param<bool>("calib_gps_frame", params.state_options.do_calib_gps_frame, params.state_options.do_calib_gps_frame);
   nh.param<int>("max_clones", params.state_options.max_clone_size, params.state_options.max_clone_size);
   nh.param<int>("max_slam", params.state_options.max_slam_features, params.state_options.max_slam_features);
   nh.param<int>("max_slam_in_update", params.state_options.max_slam_in_update, params.state_options.max_slam_in_update);
@@ -104,9 +107,23 @@ VioManagerOptions parse_ros_nodehandler(ros::NodeHandle &nh) {
   nh.param<double>("zupt_max_disparity", params.zupt_max_disparity, params.zupt_max_disparity);
   nh.param<bool>("zupt_only_at_beginning", params.zupt_only_at_beginning, params.zupt_only_at_beginning);
 
+  // GPS update
+  nh.param<bool>("gps_use_clones", params.gps_use_clones, params.gps_use_clones);
+  nh.param<double>("gps_clone_max_dt", params.gps_clone_max_dt, params.gps_clone_max_dt);
+  nh.param<double>("gps_sigma_min", params.gps_sigma_min, params.gps_sigma_min);
+  nh.param<double>("gps_sigma_unknown", params.gps_sigma_unknown, params.gps_sigma_unknown);
+
   // Recording of timing information to file
   nh.param<bool>("record_timing_information", params.record_timing_information, params.record_timing_information);
   nh.param<std::string>("record_timing_filepath", params.record_timing_filepath, params.record_timing_filepath);
+  nh.param<std::string>("log_directory", params.log_directory, params.log_directory);
+  nh.param<int>("log_max_file_mb", params.log_max_file_mb, params.log_max_file_mb);
+  nh.param<int>("log_max_files", params.log_max_files, params.log_max_files);
+
+  // Published paths
+  nh.param<int>("path_max_length", params.path_max_length, params.path_max_length);
+  nh.param<double>("path_min_distance", params.path_min_distance, params.path_min_distance);
+  nh.param<double>("path_min_dt", params.path_min_dt, params.path_min_dt);
 
   // NOISE ======================================================================
 
@@ -123,12 +140,30 @@ VioManagerOptions parse_ros_nodehandler(ros::NodeHandle &nh) {
   nh.param<double>("up_slam_chi2_multipler", params.slam_options.chi2_multipler, params.slam_options.chi2_multipler);
   nh.param<double>("up_aruco_sigma_px", params.aruco_options.sigma_pix, params.aruco_options.sigma_pix);
   nh.param<double>("up_aruco_chi2_multipler", params.aruco_options.chi2_multipler, params.aruco_options.chi2_multipler);
+  nh.param<bool>("up_householder_qr", params.msckf_options.use_householder_qr, params.msckf_options.use_householder_qr);
+  params.slam_options.use_householder_qr = params.msckf_options.use_householder_qr;
+  params.aruco_options.use_householder_qr = params.msckf_options.use_householder_qr;
+  params.zupt_options.use_householder_qr = params.msckf_options.use_householder_qr;
+  nh.param<double>("up_gps_chi2_multipler", params.gps_options.chi2_multipler, params.gps_options.chi2_multipler);
+  nh.param<double>("up_chi2_confidence", params.msckf_options.chi2_confidence, params.msckf_options.chi2_confidence);
+  params.slam_options.chi2_confidence = params.msckf_options.chi2_confidence;
+  params.aruco_options.chi2_confidence = params.msckf_options.chi2_confidence;
+  params.zupt_options.chi2_confidence = params.msckf_options.chi2_confidence;
+  params.gps_options.chi2_confidence = params.msckf_options.chi2_confidence;
 
   // STATE ======================================================================
 
   // Timeoffset from camera to IMU
   nh.param<double>("calib_camimu_dt", params.calib_camimu_dt, params.calib_camimu_dt);
 
+  // GPS lever arm and the yaw of our global frame in the GPS ENU frame
+  std::vector<double> gps_leverarm;
+  std::vector<double> gps_leverarm_default = {0, 0, 0};
+  nh.param<std::vector<double>>("gps_leverarm", gps_leverarm, gps_leverarm_default);
+  assert(gps_leverarm.size() == 3);
+  params.gps_leverarm << gps_leverarm.at(0), gps_leverarm.at(1), gps_leverarm.at(2);
+  nh.param<double>("gps_yaw_GtoENU", params.gps_yaw_GtoENU, params.gps_yaw_GtoENU);
+
   // Global gravity
   nh.param<double>("gravity_mag", params.gravity_mag, params.gravity_mag);
 
@@ -141,6 +176,17 @@ VioManagerOptions parse_ros_nodehandler(ros::NodeHandle &nh) {
   nh.param<bool>("downsize_aruco", params.downsize_aruco, params.downsize_aruco);
   nh.param<bool>("downsample_cameras", params.downsample_cameras, params.downsample_cameras);
   nh.param<bool>("multi_threading", params.use_multi_threading, params.use_multi_threading);
+  nh.param<bool>("undistort_table", params.use_undistort_table, params.use_undistort_table);
+  nh.param<bool>("klt_prediction", params.use_klt_prediction, params.use_klt_prediction);
+  nh.param<int>("klt_pred_pyr_levels", params.klt_pred_pyr_levels, params.klt_pred_pyr_levels);
+  nh.param<int>("klt_pred_max_iters", params.klt_pred_max_iters, params.klt_pred_max_iters);
+  nh.param<bool>("async_tracking", params.use_async_tracking, params.use_async_tracking);
+  nh.param<int>("async_tracking_queue_size", params.async_tracking_queue_size, params.async_tracking_queue_size);
+
+  // What to do if the estimator falls behind the tracking thread
+  std::string async_tracking_policy_str = "BLOCK";
+  nh.param<std::string>("async_tracking_policy", async_tracking_policy_str, async_tracking_policy_str);
+  params.load_async_tracking_policy(async_tracking_policy_str);
 
   // General parameters
   nh.param<int>("num_pts", params.num_pts, params.num_pts);